@@ -92,25 +92,11 @@ class KeyboardSearch
 
 			// "Jump to Next Result" mode
 			//
-			local temp = _last_search.tolower();
-
-			local s = fe.filters[fe.list.filter_index].size;
-
-			for ( local i=1; i<s; i++ )
+			if ( _last_search.len() > 0 )
 			{
-				local name = fe.game_info(Info.Title,i).tolower();
-				if ( name.len() < temp.len() )
-					continue;
-
-				// find() doesn't seem to work if the searched for
-				// text happens at the very front of the string (?)
-				if (( name.slice(0,temp.len())==temp )
-					|| (name.find( temp ) ))
-				{
-					// found match
-					fe.list.index = (fe.list.index+i)%s;
-					break;
-				}
+				local offset = fe.list.type_ahead( _last_search );
+				if ( offset != 0 )
+					fe.list.index = ( fe.list.index + offset ) % fe.list.size;
 			}
 			return true;
 		}
@@ -1029,7 +1029,7 @@ bool FeFilterEditMenu::on_option_select(
 				f->get_name() ) == false )
 			return false;
 
-		m_display->delete_filter( m_index );
+		ctx.fe_settings.delete_filter( *m_display, m_index );
 		m_display=NULL;
 		m_index=-1;
 		ctx.save_req=true;
@@ -28,6 +28,7 @@
 #include "fe_file.hpp"
 #include "fe_blend.hpp"
 #include "zip.hpp"
+#include "image_loader.hpp"
 
 #ifndef NO_MOVIE
 #include "media.hpp"
@@ -58,6 +59,10 @@ void FeBaseTextureContainer::set_vol( float vol )
 {
 }
 
+void FeBaseTextureContainer::prefetch( FeSettings *feSettings, int direction )
+{
+}
+
 void FeBaseTextureContainer::set_index_offset( int io, bool do_update )
 {
 }
@@ -201,12 +206,30 @@ namespace
 	// been experienced at 2 when returning from games).
 	//
 	const int PLAY_COUNT=5;
+
+	//
+	// The number of entries ahead of the selection (in the direction it is
+	// moving) to prefetch artwork for.
+	//
+	const int PREFETCH_COUNT=4;
+
+	//
+	// The name reported by get_file_name() for an artwork file
+	//
+	std::string artwork_name( const std::string &path,
+		const std::string &filename )
+	{
+		return is_supported_archive( path )
+			? path + "|" + filename : path + filename;
+	}
 };
 
 FeTextureContainer::FeTextureContainer(
 	bool is_artwork,
 	const std::string &art_name )
-	: m_index_offset( 0 ),
+	: m_load_request( 0 ),
+	m_mask_on_load( false ),
+	m_index_offset( 0 ),
 	m_filter_offset( 0 ),
 	m_current_rom_index( -1 ),
 	m_current_filter_index( -1 ),
@@ -233,6 +256,8 @@ FeTextureContainer::FeTextureContainer(
 
 FeTextureContainer::~FeTextureContainer()
 {
+	cancel_image_load();
+
 #ifndef NO_MOVIE
 	if ( m_movie )
 	{
@@ -252,6 +277,13 @@ FeTextureContainer::~FeTextureContainer()
 
 bool FeTextureContainer::fix_masked_image()
 {
+	// apply once the pending image is loaded
+	if ( m_load_request )
+	{
+		m_mask_on_load = true;
+		return true;
+	}
+
 	bool retval=false;
 
 	sf::Image tmp_img = m_texture.copyToImage();
@@ -278,54 +310,50 @@ bool FeTextureContainer::load_with_ffmpeg(
 	bool is_image )
 {
 	std::string loaded_name;
-	bool res=false;
+	bool is_archive = is_supported_archive( path );
 
-	if ( is_supported_archive( path ) )
-	{
+	if ( is_archive )
 		loaded_name = path + "|" + filename;
-		if ( loaded_name.compare( m_file_name ) == 0 )
-			return true;
-
-		clear();
-
-		if ( !file_exists( path ) )
-		{
-			m_texture = sf::Texture();
-			return false;
-		}
-
-		m_movie = new FeMedia( FeMedia::AudioVideo );
-		res = m_movie->open( path, filename, &m_texture );
-	}
 	else
-	{
 		loaded_name = path + filename;
-		if ( loaded_name.compare( m_file_name ) == 0 )
-			return true;
 
-		clear();
+	if ( loaded_name.compare( m_file_name ) == 0 )
+		return true;
 
-		if ( !file_exists( loaded_name ) )
-		{
-			m_texture = sf::Texture();
-			return false;
-		}
+	// already waiting to open this video
+	if ( !m_video_filename.empty() && ( filename.compare( m_video_filename ) == 0 )
+			&& ( path.compare( m_video_path ) == 0 ))
+		return true;
 
-		m_movie = new FeMedia( FeMedia::AudioVideo );
-		res = m_movie->open( "", loaded_name, &m_texture );
-	}
+	std::string shown_name;
+	shown_name.swap( m_file_name );
+	clear();
 
-	if ( !res )
+	if ( !file_exists( is_archive ? path : loaded_name ) )
 	{
-		FeLog() << "ERROR loading video: "
-			<< loaded_name << std::endl;
-
 		m_texture = sf::Texture();
-		delete m_movie;
-		m_movie = NULL;
 		return false;
 	}
 
+	//
+	// Show the poster for a video if there is one, opening the video
+	// itself is put off until it is about to play (see tick())
+	//
+	if ( !is_image && start_poster_load( path, filename ) )
+	{
+		m_movie_status = ( m_video_flags & VF_NoAutoStart ) ? 0 : 1;
+
+		// the current name stays until the poster is delivered
+		m_file_name.swap( shown_name );
+
+		// posters in the decoded image cache are ready right away
+		check_image_load();
+		return true;
+	}
+
+	if ( !open_movie( path, filename, !is_image ) )
+		return false;
+
 	if ( is_image && (!m_movie->is_multiframe()) )
 	{
 		m_movie_status = -1; // don't play if there is only one frame
@@ -340,10 +368,78 @@ bool FeTextureContainer::load_with_ffmpeg(
 	else
 		m_movie_status = 1; // 1=on track to be played
 
-	m_texture.setSmooth( m_smooth );
 	m_file_name = loaded_name;
 	return true;
 }
+
+bool FeTextureContainer::open_movie(
+	const std::string &path,
+	const std::string &filename,
+	bool save_poster )
+{
+	bool res=false;
+	m_movie = new FeMedia( FeMedia::AudioVideo );
+
+	if ( is_supported_archive( path ) )
+		res = m_movie->open( path, filename, &m_texture );
+	else
+		res = m_movie->open( "", path + filename, &m_texture );
+
+	if ( !res )
+	{
+		FeLog() << "ERROR loading video: "
+			<< path << filename << std::endl;
+
+		m_texture = sf::Texture();
+		delete m_movie;
+		m_movie = NULL;
+		return false;
+	}
+
+	const sf::Uint8 *pixels;
+	sf::Vector2u size;
+	if ( save_poster && m_movie->get_first_frame( pixels, size ) )
+		FePosterCache::get_ref().store( path, filename, pixels, size );
+
+	m_texture.setSmooth( m_smooth );
+	return true;
+}
+
+bool FeTextureContainer::start_poster_load(
+	const std::string &path,
+	const std::string &filename )
+{
+	std::string poster;
+	if ( !FePosterCache::get_ref().find( path, filename, poster ) )
+		return false;
+
+	m_video_path = path;
+	m_video_filename = filename;
+
+	m_load_path = FePosterCache::get_ref().get_path();
+	m_load_filename = poster;
+	m_load_request = FeImageLoader::get_ref().request( m_load_path, m_load_filename );
+	m_mask_on_load = false;
+	return true;
+}
+
+bool FeTextureContainer::open_pending_video()
+{
+	cancel_image_load();
+
+	std::string path, filename;
+	path.swap( m_video_path );
+	filename.swap( m_video_filename );
+
+	bool res = open_movie( path, filename, false );
+	if ( res )
+		m_file_name = artwork_name( path, filename );
+	else
+		m_movie_status = -1;
+
+	notify_texture_change();
+	return res;
+}
 #endif
 
 bool FeTextureContainer::try_to_load(
@@ -517,6 +613,150 @@ bool FeTextureContainer::load_to_texture( sf::InputStream &s )
 	return m_texture.loadFromImage( img );
 }
 
+void FeTextureContainer::load_to_texture( const sf::Uint8 *pixels,
+	const sf::Vector2u &size )
+{
+	if ( !pixels )
+		return;
+
+	// Reuse texture if we are loading an image that is the same size
+	//
+	if (( m_texture.getSize() != size ) && !m_texture.create( size.x, size.y ))
+		return;
+
+	m_texture.update( pixels, size.x, size.y, 0, 0 );
+
+#if ( SFML_VERSION_INT >= FE_VERSION_INT( 2, 4, 0 ))
+	if ( m_mipmap ) m_texture.generateMipmap();
+#endif
+	m_texture.setSmooth( m_smooth );
+}
+
+namespace
+{
+	// split the artwork name into path and filename.  Artwork in an archive
+	// is named "<archivename>|<filename>"
+	void split_artwork_name( const std::string &name,
+		std::string &path,
+		std::string &filename )
+	{
+		size_t pos = name.find( "|" );
+		if ( pos != std::string::npos )
+		{
+			path = name.substr( 0, pos );
+			filename = name.substr( pos+1 );
+		}
+		else
+		{
+			path.clear();
+			filename = name;
+		}
+	}
+};
+
+bool FeTextureContainer::start_image_load()
+{
+	if ( m_image_candidates.empty() )
+		return false;
+
+	std::string path, filename;
+	split_artwork_name( m_image_candidates.front(), path, filename );
+	m_image_candidates.erase( m_image_candidates.begin() );
+
+	// already waiting on this image
+	if ( m_load_request && m_video_filename.empty()
+			&& ( filename.compare( m_load_filename ) == 0 )
+			&& ( path.compare( m_load_path ) == 0 ))
+		return true;
+
+	// already showing this image
+	if ( !m_load_request && ( artwork_name( path, filename ).compare( m_file_name ) == 0 ))
+		return true;
+
+	//
+	// The current name stays with the current texture until the new image
+	// is delivered (see check_image_load())
+	//
+	std::string shown_name;
+	shown_name.swap( m_file_name );
+	clear();
+	m_file_name.swap( shown_name );
+
+	m_load_path = path;
+	m_load_filename = filename;
+	m_load_request = FeImageLoader::get_ref().request( path, filename );
+	m_mask_on_load = false;
+
+	// images in the decoded image cache are ready right away
+	check_image_load();
+	return true;
+}
+
+bool FeTextureContainer::check_image_load()
+{
+	const sf::Uint8 *pixels( NULL );
+	sf::Vector2u size;
+	std::string loaded_name;
+
+	FeImageLoader::Status s = FeImageLoader::get_ref().get_result(
+		m_load_request, pixels, size, loaded_name );
+
+	if ( s == FeImageLoader::Pending )
+		return false;
+
+	m_load_request = 0;
+
+	if ( s == FeImageLoader::Loaded )
+	{
+		load_to_texture( pixels, size );
+
+		// a poster stands in for the video waiting to be opened
+		m_file_name = m_video_filename.empty()
+			? loaded_name : artwork_name( m_video_path, m_video_filename );
+	}
+	else if ( m_video_filename.empty() )
+	{
+		bool loaded=false;
+
+#ifndef NO_MOVIE
+		//
+		// SFML couldn't decode the image, try loading it with ffmpeg
+		// instead, which can handle more image formats...
+		//
+		if ( s == FeImageLoader::Failed )
+			loaded = load_with_ffmpeg( m_load_path, m_load_filename, true );
+#endif
+
+		if ( !loaded )
+		{
+			// move on to the next image, the current texture stays until then
+			if ( start_image_load() )
+				return false;
+
+			m_file_name.clear();
+			m_texture = sf::Texture();
+		}
+	}
+
+	if ( m_mask_on_load )
+	{
+		m_mask_on_load = false;
+		fix_masked_image();
+	}
+
+	notify_texture_change();
+	return true;
+}
+
+void FeTextureContainer::cancel_image_load()
+{
+	if ( m_load_request )
+	{
+		FeImageLoader::get_ref().cancel( m_load_request );
+		m_load_request = 0;
+	}
+}
+
 const sf::Texture &FeTextureContainer::get_texture()
 {
 #ifndef NO_SWF
@@ -642,30 +882,12 @@ void FeTextureContainer::internal_update_selection( FeSettings *feSettings )
 		}
 		else
 		{
-			for ( itr=image_list.begin();
-				itr != image_list.end(); ++itr )
-			{
-				std::string path = archive_name;
-				std::string filename = *itr;
-
-				if ( path.empty() )
-				{
-					// test for artwork in an archive
-					// format of filename is "<archivename>|<filename>"
-					size_t pos = (*itr).find( "|" );
-					if ( pos != std::string::npos )
-					{
-						path = (*itr).substr( 0, pos );
-						filename = (*itr).substr( pos+1 );
-					}
-				}
-
-				if ( try_to_load( path, filename, true ) )
-				{
-					loaded = true;
-					break;
-				}
-			}
+			//
+			// Images are decoded in the background and picked up in tick().
+			// Any earlier request still pending is cancelled.
+			//
+			m_image_candidates.swap( image_list );
+			start_image_load();
 		}
 	}
 
@@ -675,8 +897,61 @@ void FeTextureContainer::internal_update_selection( FeSettings *feSettings )
 	notify_texture_change();
 }
 
+void FeTextureContainer::prefetch( FeSettings *feSettings, int direction )
+{
+	// dynamic images depend on the current selection, so only artwork
+	// can be worked out ahead of time
+	if (( m_type != IsArtwork ) || ( direction == 0 ))
+		return;
+
+	int filter_index = feSettings->get_filter_index_from_offset( m_filter_offset );
+	int step = ( direction > 0 ) ? 1 : -1;
+
+	for ( int i=1; i<=PREFETCH_COUNT; i++ )
+	{
+		int rom_index = feSettings->get_rom_index( filter_index, m_index_offset + i * step );
+		FeRomInfo *rom = feSettings->get_rom_absolute( filter_index, rom_index );
+		if ( !rom )
+			break;
+
+		std::vector<std::string> vid_list;
+		std::vector<std::string> image_list;
+
+		feSettings->get_best_artwork_file( *rom,
+			m_art_name,
+			vid_list,
+			image_list,
+			(m_video_flags & VF_DisableVideo) );
+
+		// a video would be shown instead, so prefetch its poster
+#ifndef NO_MOVIE
+		if ( !( m_video_flags & VF_DisableVideo ) && !vid_list.empty() )
+		{
+			std::string path, filename, poster;
+			split_artwork_name( vid_list.front(), path, filename );
+
+			if ( FePosterCache::get_ref().find( path, filename, poster ) )
+				FeImageLoader::get_ref().prefetch(
+					FePosterCache::get_ref().get_path(), poster );
+
+			continue;
+		}
+#endif
+
+		if ( !image_list.empty() )
+		{
+			std::string path, filename;
+			split_artwork_name( image_list.front(), path, filename );
+			FeImageLoader::get_ref().prefetch( path, filename );
+		}
+	}
+}
+
 bool FeTextureContainer::tick( FeSettings *feSettings, bool play_movies )
 {
+	if ( m_load_request && check_image_load() )
+		return true;
+
 	if ( !play_movies || (m_video_flags & VF_DisableVideo) )
 		return false;
 
@@ -686,7 +961,7 @@ bool FeTextureContainer::tick( FeSettings *feSettings, bool play_movies )
 #endif
 
 #ifndef NO_MOVIE
-	if (( m_movie ) && ( m_movie_status > 0 ))
+	if (( m_movie || !m_video_filename.empty() ) && ( m_movie_status > 0 ))
 	{
 		if ( m_movie_status < PLAY_COUNT )
 		{
@@ -703,6 +978,10 @@ bool FeTextureContainer::tick( FeSettings *feSettings, bool play_movies )
 		{
 			m_movie_status++;
 
+			// only the poster is showing so far, open the video now
+			if ( !m_movie && !open_pending_video() )
+				return true;
+
 			//
 			// Start playing now if this is a video...
 			//
@@ -747,7 +1026,7 @@ void FeTextureContainer::set_play_state( bool play )
 #endif
 
 #ifndef NO_MOVIE
-	if (m_movie)
+	if ( m_movie || !m_video_filename.empty() )
 	{
 		if ( play == get_play_state() )
 			return;
@@ -784,7 +1063,7 @@ bool FeTextureContainer::get_play_state() const
 #endif
 
 #ifndef NO_MOVIE
-	if ( m_movie )
+	if ( m_movie || !m_video_filename.empty() )
 	{
 		if ( m_movie_status > PLAY_COUNT )
 			return m_movie->is_playing();
@@ -906,6 +1185,7 @@ void FeTextureContainer::load_from_archive( const char *a, const char *n )
 		path = FePresent::script_get_base_path();
 
 	bool is_image=tail_compare( filename, FE_ART_EXTENSIONS );
+	m_image_candidates.clear();
 	try_to_load( path, filename, is_image );
 	notify_texture_change();
 }
@@ -950,6 +1230,9 @@ void FeTextureContainer::clear()
 {
 	m_movie_status = -1;
 	m_file_name.clear();
+	cancel_image_load();
+	m_video_path.clear();
+	m_video_filename.clear();
 
 #ifndef NO_SWF
 	if ( m_swf )
@@ -59,6 +59,9 @@ public:
 
 	virtual bool tick( FeSettings *feSettings, bool play_movies ); // returns true if redraw required
 
+	// start loading artwork for the entries the selection is moving towards
+	virtual void prefetch( FeSettings *feSettings, int direction );
+
 	virtual void set_play_state( bool play );
 	virtual bool get_play_state() const;
 	virtual void set_vol( float vol );
@@ -131,6 +134,7 @@ public:
 	void on_new_list( FeSettings *, bool );
 
 	bool tick( FeSettings *feSettings, bool play_movies ); // returns true if redraw required
+	void prefetch( FeSettings *feSettings, int direction );
 	void set_play_state( bool play );
 	bool get_play_state() const;
 	void set_vol( float vol );
@@ -174,6 +178,17 @@ private:
 		const std::string &path,
 		const std::string &filename,
 		bool is_image );
+
+	bool open_movie(
+		const std::string &path,
+		const std::string &filename,
+		bool save_poster );
+
+	// Videos that have a poster (see FePosterCache) show it until they
+	// are about to play, then the video itself gets opened
+	//
+	bool start_poster_load( const std::string &path, const std::string &filename );
+	bool open_pending_video();
 #endif
 
 	bool try_to_load(
@@ -182,6 +197,14 @@ private:
 		bool is_image=false );
 
 	bool load_to_texture( sf::InputStream &s );
+	void load_to_texture( const sf::Uint8 *pixels, const sf::Vector2u &size );
+
+	// Images for artwork are decoded by FeImageLoader threads.  The current
+	// texture is kept until the new one is ready (see check_image_load())
+	//
+	bool start_image_load();
+	bool check_image_load(); // returns true if the texture changed
+	void cancel_image_load();
 
 	void internal_update_selection( FeSettings *feSettings );
 	void clear();
@@ -190,6 +213,13 @@ private:
 
 	std::string m_art_name; // artwork label/template name (dynamic images)
 	std::string m_file_name; // the name of the loaded file
+	std::vector< std::string > m_image_candidates; // images still to try if the pending one fails
+	std::string m_load_path; // path and filename of the pending image
+	std::string m_load_filename;
+	int m_load_request; // FeImageLoader request id of the pending image, 0 if none
+	bool m_mask_on_load; // fix_masked_image() was called while an image was pending
+	std::string m_video_path; // path and filename of the video to open after its poster
+	std::string m_video_filename;
 	int m_index_offset;
 	int m_filter_offset;
 	int m_current_rom_index;
@@ -22,10 +22,15 @@
 
 #include "fe_info.hpp"
 #include "fe_util.hpp"
+#include "stats_store.hpp"
 #include <iostream>
 #include <sstream>
 
 #include <iomanip>
+#include <deque>
+#include <algorithm>
+
+#include <SFML/System/Thread.hpp>
 
 #include <squirrel.h>
 #include <sqstdstring.h>
@@ -67,35 +72,328 @@ const char *FeRomInfo::indexStrings[] =
 	NULL
 };
 
+namespace
+{
+	// hash table slot values used by FeInfoColumn
+	const sf::Uint32 EMPTY_SLOT = 0;
+	const sf::Uint32 DELETED_SLOT = 0xFFFFFFFF;
+
+	//
+	// Interned string storage for a single FeRomInfo attribute (a "column").
+	//
+	// Each distinct value is stored once and identified by its index, with
+	// index 0 reserved for the empty string.  Values are reference counted
+	// by the FeRomInfo objects using them and released when no longer used.
+	//
+	// This is not thread safe.  FeRomInfo objects can be read from worker
+	// threads, but must only be created, copied or changed from one thread
+	// at a time.
+	//
+	class FeInfoColumn
+	{
+	public:
+		FeInfoColumn();
+
+		sf::Uint32 intern( const std::string &s );
+		bool find( const std::string &s, sf::Uint32 &id ) const; // lookup only, no reference added
+		void add_ref( sf::Uint32 id ) { if ( id ) m_entries[id].refs++; };
+		void release( sf::Uint32 id );
+
+		const std::string &get( sf::Uint32 id ) const { return m_entries[id].str; };
+		sf::Uint32 get_serial( sf::Uint32 id ) const { return m_entries[id].serial; };
+		sf::Uint32 get_generation() const { return m_next_serial; };
+		sf::Uint32 size() const { return m_entries.size(); };
+
+	private:
+		struct Entry
+		{
+			std::string str;
+			sf::Uint32 hash;
+			sf::Uint32 refs;
+			sf::Uint32 serial; // changes whenever the id is reused for a new value
+		};
+
+		// a deque so that references to stored strings are never
+		// invalidated by later additions
+		std::deque<Entry> m_entries;
+		std::vector<sf::Uint32> m_free;
+		sf::Uint32 m_next_serial;
+
+		// open addressing hash table of entry indices
+		std::vector<sf::Uint32> m_table;
+		sf::Uint32 m_table_used; // slots that are not EMPTY_SLOT
+
+		static sf::Uint32 get_hash( const std::string &s );
+		void rebuild_table( size_t size );
+	};
+
+	FeInfoColumn::FeInfoColumn()
+		: m_next_serial( 2 ),
+		m_table( 64, EMPTY_SLOT ),
+		m_table_used( 0 )
+	{
+		Entry e;
+		e.hash = 0;
+		e.refs = 0;
+		e.serial = 1;
+		m_entries.push_back( e );
+	}
+
+	sf::Uint32 FeInfoColumn::get_hash( const std::string &s )
+	{
+		// FNV-1a
+		sf::Uint32 h = 2166136261u;
+		for ( std::string::const_iterator itr=s.begin(); itr!=s.end(); ++itr )
+		{
+			h ^= (unsigned char)(*itr);
+			h *= 16777619u;
+		}
+		return h;
+	}
+
+	sf::Uint32 FeInfoColumn::intern( const std::string &s )
+	{
+		if ( s.empty() )
+			return 0;
+
+		sf::Uint32 h = get_hash( s );
+		size_t mask = m_table.size() - 1;
+		size_t pos = h & mask;
+		size_t insert_pos = m_table.size();
+
+		while ( m_table[pos] != EMPTY_SLOT )
+		{
+			sf::Uint32 id = m_table[pos];
+			if ( id == DELETED_SLOT )
+			{
+				if ( insert_pos == m_table.size() )
+					insert_pos = pos;
+			}
+			else if (( m_entries[id].hash == h ) && ( m_entries[id].str.compare( s ) == 0 ))
+			{
+				m_entries[id].refs++;
+				return id;
+			}
+
+			pos = ( pos + 1 ) & mask;
+		}
+
+		sf::Uint32 id;
+		if ( m_free.empty() )
+		{
+			id = m_entries.size();
+			m_entries.push_back( Entry() );
+		}
+		else
+		{
+			id = m_free.back();
+			m_free.pop_back();
+		}
+
+		Entry &e = m_entries[id];
+		e.str = s;
+		e.hash = h;
+		e.refs = 1;
+		e.serial = m_next_serial++;
+
+		if ( m_next_serial == 0 )
+			m_next_serial = 2;
+
+		if ( insert_pos == m_table.size() )
+		{
+			insert_pos = pos;
+			m_table_used++;
+		}
+
+		m_table[insert_pos] = id;
+
+		// keep the table at most half full
+		if ( m_table_used * 2 > m_table.size() )
+			rebuild_table( ( m_entries.size() - m_free.size() ) * 4 );
+
+		return id;
+	}
+
+	bool FeInfoColumn::find( const std::string &s, sf::Uint32 &id ) const
+	{
+		if ( s.empty() )
+		{
+			id = 0;
+			return true;
+		}
+
+		sf::Uint32 h = get_hash( s );
+		size_t mask = m_table.size() - 1;
+		size_t pos = h & mask;
+
+		while ( m_table[pos] != EMPTY_SLOT )
+		{
+			sf::Uint32 e = m_table[pos];
+			if (( e != DELETED_SLOT )
+					&& ( m_entries[e].hash == h ) && ( m_entries[e].str.compare( s ) == 0 ))
+			{
+				id = e;
+				return true;
+			}
+
+			pos = ( pos + 1 ) & mask;
+		}
+
+		return false;
+	}
+
+	void FeInfoColumn::release( sf::Uint32 id )
+	{
+		if (( id == 0 ) || ( --m_entries[id].refs > 0 ))
+			return;
+
+		size_t mask = m_table.size() - 1;
+		size_t pos = m_entries[id].hash & mask;
+
+		while ( m_table[pos] != id )
+		{
+			ASSERT( m_table[pos] != EMPTY_SLOT );
+			pos = ( pos + 1 ) & mask;
+		}
+
+		m_table[pos] = DELETED_SLOT;
+		std::string().swap( m_entries[id].str );
+		m_free.push_back( id );
+	}
+
+	void FeInfoColumn::rebuild_table( size_t size )
+	{
+		size_t new_size = 64;
+		while ( new_size < size )
+			new_size *= 2;
+
+		m_table.assign( new_size, EMPTY_SLOT );
+		m_table_used = 0;
+
+		size_t mask = new_size - 1;
+		for ( sf::Uint32 id=1; id<m_entries.size(); id++ )
+		{
+			if ( m_entries[id].refs == 0 )
+				continue;
+
+			size_t pos = m_entries[id].hash & mask;
+			while ( m_table[pos] != EMPTY_SLOT )
+				pos = ( pos + 1 ) & mask;
+
+			m_table[pos] = id;
+			m_table_used++;
+		}
+	}
+
+	FeInfoColumn *get_columns()
+	{
+		// Intentionally never deleted, since FeRomInfo objects can outlive
+		// static destruction
+		static FeInfoColumn *columns = new FeInfoColumn[ FeRomInfo::LAST_INDEX ];
+		return columns;
+	}
+};
+
 FeRomInfo::FeRomInfo()
 {
+	for ( int i=0; i < LAST_INDEX; i++ )
+		m_info[i] = 0;
 }
 
 FeRomInfo::FeRomInfo( const std::string &rn )
 {
-	m_info[Romname] = rn;
+	for ( int i=0; i < LAST_INDEX; i++ )
+		m_info[i] = 0;
+
+	m_info[Romname] = get_columns()[Romname].intern( rn );
+}
+
+FeRomInfo::FeRomInfo( const FeRomInfo &o )
+	: FeBaseConfigurable( o )
+{
+	FeInfoColumn *c = get_columns();
+	for ( int i=0; i < LAST_INDEX; i++ )
+	{
+		m_info[i] = o.m_info[i];
+		c[i].add_ref( m_info[i] );
+	}
+}
+
+FeRomInfo::~FeRomInfo()
+{
+	clear();
+}
+
+FeRomInfo &FeRomInfo::operator=( const FeRomInfo &o )
+{
+	FeInfoColumn *c = get_columns();
+	for ( int i=0; i < LAST_INDEX; i++ )
+	{
+		// add before release in case this is a self assignment
+		c[i].add_ref( o.m_info[i] );
+		c[i].release( m_info[i] );
+		m_info[i] = o.m_info[i];
+	}
+
+	return *this;
 }
 
 const std::string &FeRomInfo::get_info( int i ) const
+{
+	return get_columns()[i].get( m_info[i] );
+}
+
+sf::Uint32 FeRomInfo::get_info_id( Index i ) const
 {
 	return m_info[i];
 }
 
+sf::Uint32 FeRomInfo::get_column_size( Index i )
+{
+	return get_columns()[i].size();
+}
+
+const std::string &FeRomInfo::get_column_value( Index i, sf::Uint32 id )
+{
+	return get_columns()[i].get( id );
+}
+
+bool FeRomInfo::find_column_id( Index i, const std::string &value, sf::Uint32 &id )
+{
+	return get_columns()[i].find( value, id );
+}
+
+sf::Uint32 FeRomInfo::get_column_serial( Index i, sf::Uint32 id )
+{
+	return get_columns()[i].get_serial( id );
+}
+
+sf::Uint32 FeRomInfo::get_column_generation( Index i )
+{
+	return get_columns()[i].get_generation();
+}
+
 std::string FeRomInfo::get_info_escaped( int i ) const
 {
-	if ( m_info[i].find_first_of( ';' ) != std::string::npos )
+	const std::string &v = get_info( i );
+	if ( v.find_first_of( ';' ) != std::string::npos )
 	{
-		std::string temp = m_info[i];
+		std::string temp = v;
 		perform_substitution( temp, "\"", "\\\"" );
 		return ( "\"" + temp + "\"" );
 	}
 	else
-		return m_info[i];
+		return v;
 }
 
 void FeRomInfo::set_info( Index i, const std::string &v )
 {
-	m_info[i] = v;
+	FeInfoColumn &c = get_columns()[i];
+
+	// intern before release, in case "v" refers to our current value
+	sf::Uint32 id = c.intern( v );
+	c.release( m_info[i] );
+	m_info[i] = id;
 }
 
 void FeRomInfo::append_tag( const std::string &tag )
@@ -104,63 +402,37 @@ void FeRomInfo::append_tag( const std::string &tag )
 	// The tags logic requires a FE_TAGS_SEP character on each side of
 	// a tag.
 	//
-	if ( m_info[Tags].empty() )
-		m_info[Tags] = FE_TAGS_SEP;
+	std::string temp = get_info( Tags );
+	if ( temp.empty() )
+		temp = FE_TAGS_SEP;
 
-	m_info[Tags] += tag;
-	m_info[Tags] += FE_TAGS_SEP;
+	temp += tag;
+	temp += FE_TAGS_SEP;
+	set_info( Tags, temp );
 }
 
-void FeRomInfo::load_stats( const std::string &path )
+void FeRomInfo::load_stats( const FeStatsStore &stats )
 {
 	// Check if stats already loaded for this one
-	if ( !m_info[PlayedCount].empty() )
+	if ( m_info[PlayedCount] )
 		return;
 
-	m_info[PlayedCount] = "0";
-	m_info[PlayedTime] = "0";
-
-	std::string filename = path + m_info[Romname] + FE_STAT_FILE_EXTENSION;
-	nowide::ifstream myfile( filename.c_str() );
-
-	if ( !myfile.is_open() )
-		return;
-
-	std::string line;
-	if ( myfile.good() )
-	{
-		getline( myfile, line );
-		m_info[PlayedCount] = line;
-	}
-
-	if ( myfile.good() )
-	{
-		getline( myfile, line );
-		m_info[PlayedTime] = line;
-	}
+	int count( 0 ), time( 0 );
+	stats.get( get_info( Romname ), count, time );
 
-	myfile.close();
+	set_info( PlayedCount, as_str( count ) );
+	set_info( PlayedTime, as_str( time ) );
 }
 
-void FeRomInfo::update_stats( const std::string &path, int count_incr, int played_incr )
+void FeRomInfo::update_stats( FeStatsStore &stats, int count_incr, int played_incr )
 {
-	int new_count = as_int( m_info[PlayedCount] ) + count_incr;
-	int new_time = as_int( m_info[PlayedTime] ) + played_incr;
-
-	m_info[PlayedCount] = as_str( new_count );
-	m_info[PlayedTime] = as_str( new_time );
+	int new_count = as_int( get_info( PlayedCount ) ) + count_incr;
+	int new_time = as_int( get_info( PlayedTime ) ) + played_incr;
 
-	std::string filename = path + m_info[Romname] + FE_STAT_FILE_EXTENSION;
-	nowide::ofstream myfile( filename.c_str() );
+	set_info( PlayedCount, as_str( new_count ) );
+	set_info( PlayedTime, as_str( new_time ) );
 
-	if ( !myfile.is_open() )
-	{
-		FeLog() << "Error writing stat file: " << filename << std::endl;
-		return;
-	}
-
-	myfile << m_info[PlayedCount] << std::endl << m_info[PlayedTime] << std::endl;
-	myfile.close();
+	stats.set( get_info( Romname ), new_count, new_time );
 }
 
 int FeRomInfo::process_setting( const std::string &,
@@ -172,7 +444,7 @@ int FeRomInfo::process_setting( const std::string &,
 	for ( int i=1; i < Favourite; i++ )
 	{
 		token_helper( value, pos, token );
-		m_info[(Index)i] = token;
+		set_info( (Index)i, token );
 	}
 
 	return 0;
@@ -192,19 +464,29 @@ std::string FeRomInfo::as_output( void ) const
 
 void FeRomInfo::clear()
 {
+	FeInfoColumn *c = get_columns();
 	for ( int i=0; i < LAST_INDEX; i++ )
-		m_info[i].clear();
+	{
+		c[i].release( m_info[i] );
+		m_info[i] = 0;
+	}
 }
 
 void FeRomInfo::copy_info( const FeRomInfo &src, Index idx )
 {
-	m_info[idx]=src.m_info[idx];
+	FeInfoColumn &c = get_columns()[idx];
+	c.add_ref( src.m_info[idx] );
+	c.release( m_info[idx] );
+	m_info[idx] = src.m_info[idx];
 }
 
+//
+// Values are interned per attribute, so equal ids means equal strings
+//
 bool FeRomInfo::operator==( const FeRomInfo &o ) const
 {
-	return (( m_info[Romname].compare( o.m_info[Romname] ) == 0 )
-				&& ( m_info[Emulator].compare( o.m_info[Emulator] ) == 0 ));
+	return (( m_info[Romname] == o.m_info[Romname] )
+				&& ( m_info[Emulator] == o.m_info[Emulator] ));
 }
 
 bool FeRomInfo::full_comparison( const FeRomInfo &o ) const
@@ -212,7 +494,7 @@ bool FeRomInfo::full_comparison( const FeRomInfo &o ) const
 	// everything from Favourite on is not loaded from the romlist
 	for ( int i=0; i<Favourite; i++ )
 	{
-		if ( m_info[i].compare( o.m_info[i] ) != 0 )
+		if ( m_info[i] != o.m_info[i] )
 			return false;
 	}
 
@@ -242,6 +524,8 @@ FeRule::FeRule( FeRomInfo::Index t, FilterComp c, const std::string &w )
 	m_filter_comp( c ),
 	m_filter_what( w ),
 	m_rex( NULL ),
+	m_compiled( false ),
+	m_literal( false ),
 	m_is_exception( false )
 {
 }
@@ -251,6 +535,8 @@ FeRule::FeRule( const FeRule &r )
 	m_filter_comp( r.m_filter_comp ),
 	m_filter_what( r.m_filter_what ),
 	m_rex( NULL ),
+	m_compiled( false ),
+	m_literal( false ),
 	m_is_exception( r.m_is_exception )
 {
 }
@@ -268,18 +554,37 @@ FeRule &FeRule::operator=( const FeRule &r )
 	m_filter_what = r.m_filter_what;
 	m_is_exception = r.m_is_exception;
 
+	clear_compiled();
+	return *this;
+}
+
+void FeRule::clear_compiled()
+{
 	if ( m_rex )
 		sqstd_rex_free( m_rex );
 
 	m_rex = NULL;
-	return *this;
+	m_compiled = false;
+	m_literal = false;
+	m_memo.clear();
 }
 
 void FeRule::init()
 {
-	if (( m_rex ) || ( m_filter_what.empty() ))
+	if (( m_compiled ) || ( m_filter_what.empty() ))
 		return;
 
+	//
+	// Most rules are plain text, which we can compare directly without
+	// going through the regular expression engine
+	//
+	if ( m_filter_what.find_first_of( "\\^$.|?*+()[]{}" ) == std::string::npos )
+	{
+		m_literal = true;
+		m_compiled = true;
+		return;
+	}
+
 	//
 	// Compile the regular expression now
 	//
@@ -290,18 +595,41 @@ void FeRule::init()
 	if ( !m_rex )
 		FeLog() << "Error compiling regular expression \""
 			<< m_filter_what << "\": " << err << std::endl;
+	else
+		m_compiled = true;
 }
 
 bool FeRule::apply_rule( const FeRomInfo &rom ) const
 {
 	if (( m_filter_target == FeRomInfo::LAST_INDEX )
 		|| ( m_filter_comp == FeRule::LAST_COMPARISON )
-		|| ( m_rex == NULL ))
+		|| ( !m_compiled ))
 		return true;
 
+	//
+	// The result only depends on the target value, so remember it for
+	// each distinct (interned) value we see.
+	//
+	sf::Uint32 id = rom.get_info_id( m_filter_target );
+	if ( id >= m_memo.size() )
+		m_memo.resize( FeRomInfo::get_column_size( m_filter_target ) );
+
+	sf::Uint32 serial = FeRomInfo::get_column_serial( m_filter_target, id );
+	MemoEntry &m = m_memo[id];
+
+	if ( m.serial != serial )
+	{
+		m.serial = serial;
+		m.result = compare( rom.get_info( m_filter_target ) );
+	}
+
+	return m.result;
+}
+
+bool FeRule::compare( const std::string &target ) const
+{
 	const SQChar *begin( NULL );
 	const SQChar *end( NULL );
-	const std::string &target = rom.get_info( m_filter_target );
 
 	switch ( m_filter_comp )
 	{
@@ -309,6 +637,9 @@ bool FeRule::apply_rule( const FeRomInfo &rom ) const
 		if ( target.empty() )
 			return ( m_filter_what.empty() );
 
+		if ( m_literal )
+			return ( target.compare( m_filter_what ) == 0 );
+
 		return ( sqstd_rex_match(
 					m_rex,
 					(const SQChar *)target.c_str() ) == SQTrue );
@@ -317,6 +648,9 @@ bool FeRule::apply_rule( const FeRomInfo &rom ) const
 		if ( target.empty() )
 			return ( !m_filter_what.empty() );
 
+		if ( m_literal )
+			return ( target.compare( m_filter_what ) != 0 );
+
 		return ( sqstd_rex_match(
 					m_rex,
 					(const SQChar *)target.c_str() ) != SQTrue );
@@ -325,6 +659,9 @@ bool FeRule::apply_rule( const FeRomInfo &rom ) const
 		if ( target.empty() )
 			return false;
 
+		if ( m_literal )
+			return ( target.find( m_filter_what ) != std::string::npos );
+
 		return ( sqstd_rex_search(
 					m_rex,
 					(const SQChar *)target.c_str(),
@@ -335,6 +672,9 @@ bool FeRule::apply_rule( const FeRomInfo &rom ) const
 		if ( target.empty() )
 			return true;
 
+		if ( m_literal )
+			return ( target.find( m_filter_what ) == std::string::npos );
+
 		return ( sqstd_rex_search(
 					m_rex,
 					(const SQChar *)target.c_str(),
@@ -367,10 +707,7 @@ void FeRule::set_values(
 		FilterComp c,
 		const std::string &w )
 {
-	if ( m_rex )
-		sqstd_rex_free( m_rex );
-
-	m_rex = NULL;
+	clear_compiled();
 
 	m_filter_target = i;
 	m_filter_comp = c;
@@ -1185,35 +1522,121 @@ void FeEmulatorInfo::gather_rom_names( std::vector<std::string> &name_list ) con
 	gather_rom_names( name_list, ignored );
 }
 
+namespace
+{
+	//
+	// Results of scanning one rom path, with one list of base names per
+	// file extension and the subdirectory names (if the emulator uses
+	// FE_DIR_TOKEN)
+	//
+	struct FeRomPathScan
+	{
+		std::string path;
+		std::vector< std::vector<std::string> > lists;
+		std::vector<std::string> dirs;
+	};
+
+	struct FeRomPathWorker
+	{
+		std::vector< FeRomPathScan > *scans;
+		const std::vector< std::string > *file_exts;
+		bool want_dirs;
+		int first;
+		int stride;
+	};
+
+	void scan_rom_paths( FeRomPathWorker *w )
+	{
+		for ( int i=w->first; i<(int)w->scans->size(); i+=w->stride )
+		{
+			FeRomPathScan &s = (*w->scans)[i];
+
+			get_basenames_from_extensions( s.lists, s.path, *(w->file_exts) );
+
+			if ( w->want_dirs )
+				get_subdirectories( s.dirs, s.path );
+		}
+	}
+};
+
 void FeEmulatorInfo::gather_rom_names(
 	std::vector<std::string> &name_list,
 	std::vector<std::string> &full_path_list ) const
 {
-	for ( std::vector<std::string>::const_iterator itr=m_paths.begin();
-			itr!=m_paths.end(); ++itr )
+	if ( m_paths.empty() )
+		return;
+
+	//
+	// Each rom path is read once, with every entry classified against the
+	// full extension list.  Paths are scanned in parallel when there is
+	// more than one of them, since they are often on different devices.
+	//
+	std::vector< std::string > file_exts;
+	bool want_dirs=false;
+
+	std::vector<std::string>::const_iterator ite;
+	for ( ite = m_extensions.begin(); ite != m_extensions.end(); ++ite )
 	{
-		std::string path = clean_path_with_wd( *itr, true );
+		if ( (*ite).compare( FE_DIR_TOKEN ) == 0 )
+			want_dirs = true;
+		else
+			file_exts.push_back( *ite );
+	}
 
-		for ( std::vector<std::string>::const_iterator ite = m_extensions.begin();
-				ite != m_extensions.end(); ++ite )
+	std::vector< FeRomPathScan > scans( m_paths.size() );
+	for ( unsigned int i=0; i<m_paths.size(); i++ )
+		scans[i].path = clean_path_with_wd( m_paths[i], true );
+
+	int worker_count = std::min( (int)scans.size(), get_processor_count() );
+	std::vector< FeRomPathWorker > workers( worker_count );
+	std::vector< sf::Thread * > threads;
+
+	for ( int i=0; i<worker_count; i++ )
+	{
+		workers[i].scans = &scans;
+		workers[i].file_exts = &file_exts;
+		workers[i].want_dirs = want_dirs;
+		workers[i].first = i;
+		workers[i].stride = worker_count;
+
+		if ( i > 0 )
 		{
-			std::vector<std::string> temp_list;
-			std::vector<std::string>::iterator itn;
+			threads.push_back( new sf::Thread( &scan_rom_paths, &( workers[i] ) ) );
+			threads.back()->launch();
+		}
+	}
 
+	scan_rom_paths( &( workers[0] ) );
+
+	for ( std::vector< sf::Thread * >::iterator itr=threads.begin(); itr!=threads.end(); ++itr )
+	{
+		(*itr)->wait();
+		delete (*itr);
+	}
+
+	//
+	// Merge in path order and then extension order, as the lists were
+	// gathered before
+	//
+	for ( std::vector< FeRomPathScan >::iterator its=scans.begin(); its!=scans.end(); ++its )
+	{
+		const std::string &path = (*its).path;
+		std::vector<std::string>::iterator itn;
+		int ext_index=0;
+
+		for ( ite = m_extensions.begin(); ite != m_extensions.end(); ++ite )
+		{
 			if ( (*ite).compare( FE_DIR_TOKEN ) == 0 )
 			{
-				get_subdirectories( temp_list, path );
-
-				for ( itn = temp_list.begin(); itn != temp_list.end(); ++itn )
+				for ( itn = (*its).dirs.begin(); itn != (*its).dirs.end(); ++itn )
 				{
 					full_path_list.push_back( path + *itn );
-					name_list.push_back( std::string() );
-					name_list.back().swap( *itn );
+					name_list.push_back( *itn );
 				}
 			}
 			else
 			{
-				get_basename_from_extension( temp_list, path, (*ite), true );
+				std::vector<std::string> &temp_list = (*its).lists[ ext_index++ ];
 
 				for ( itn = temp_list.begin(); itn != temp_list.end(); ++itn )
 				{
@@ -27,6 +27,7 @@
 #include <map>
 #include <vector>
 #include "nowide/fstream.hpp"
+#include <SFML/Config.hpp>
 
 extern const char *FE_STAT_FILE_EXTENSION;
 extern const char FE_TAGS_SEP;
@@ -35,6 +36,8 @@ struct SQRex;
 //
 // Class for storing information regarding a specific rom
 //
+class FeStatsStore;
+
 class FeRomInfo : public FeBaseConfigurable
 {
 public:
@@ -78,10 +81,34 @@ public:
 
 	FeRomInfo();
 	FeRomInfo( const std::string &romname );
+	FeRomInfo( const FeRomInfo & );
+	~FeRomInfo();
+
+	FeRomInfo &operator=( const FeRomInfo & );
 
 	const std::string &get_info( int ) const;
 	void set_info( enum Index, const std::string & );
 
+	//
+	// Attribute values are interned per attribute (column), and the ids
+	// can be used to compare or memoize values without string compares.
+	// Id 0 is always the empty string.
+	//
+	sf::Uint32 get_info_id( Index ) const;
+	static sf::Uint32 get_column_size( Index ); // all ids for the attribute are < this
+	static const std::string &get_column_value( Index, sf::Uint32 id );
+
+	// get the id of "value" if it is currently in use for the attribute.
+	// returns false if no rom has that value
+	static bool find_column_id( Index, const std::string &value, sf::Uint32 &id );
+
+	// returns a number that changes whenever the id is reused for another value
+	static sf::Uint32 get_column_serial( Index, sf::Uint32 id );
+
+	// returns a number that changes whenever a new value is added to the
+	// attribute (i.e. whenever a value id is assigned or reused)
+	static sf::Uint32 get_column_generation( Index );
+
 	void append_tag( const std::string &tag );
 
 	int process_setting( const std::string &setting,
@@ -89,8 +116,8 @@ public:
 		const std::string &fn );
 	std::string as_output( void ) const;
 
-	void load_stats( const std::string &path );
-	void update_stats( const std::string &path, int count_incr, int played_incr );
+	void load_stats( const FeStatsStore &stats );
+	void update_stats( FeStatsStore &stats, int count_incr, int played_incr );
 
 	void clear();
 
@@ -103,7 +130,7 @@ public:
 private:
 	std::string get_info_escaped( int ) const;
 
-	std::string m_info[LAST_INDEX];
+	sf::Uint32 m_info[LAST_INDEX]; // interned value ids
 };
 
 //
@@ -149,10 +176,24 @@ public:
          const std::string &value, const std::string &fn );
 
 private:
+	struct MemoEntry
+	{
+		MemoEntry() : serial( 0 ), result( false ) {};
+
+		sf::Uint32 serial;
+		bool result;
+	};
+
+	bool compare( const std::string &target ) const;
+	void clear_compiled();
+
 	FeRomInfo::Index m_filter_target;
 	FilterComp m_filter_comp;
 	std::string m_filter_what;
 	SQRex *m_rex;
+	bool m_compiled;
+	bool m_literal; // m_filter_what has no regular expression metacharacters
+	mutable std::vector<MemoEntry> m_memo; // results by interned target value id
 	bool m_is_exception;
 };
 
@@ -26,6 +26,18 @@
 #include "fe_present.hpp"
 #include "fe_util.hpp"
 #include <iostream>
+#include <algorithm>
+
+namespace
+{
+	//
+	// The number of rows formatted ahead of and behind the visible rows
+	// when the game list is scrolled, and the number of formatted rows that
+	// are kept before the row cache gets trimmed
+	//
+	const int ROW_MARGIN = 8;
+	const int ROW_CACHE_MAX = 256;
+};
 
 FeListBox::FeListBox( FePresentableParent &p, int x, int y, int w, int h )
 	: FeBasePresentable( p ),
@@ -37,6 +49,9 @@ FeListBox::FeListBox( FePresentableParent &p, int x, int y, int w, int h )
 	m_filter_offset( 0 ),
 	m_rotation( 0.0 ),
 	m_scale_factor( 1.0 ),
+	m_list_filter_index( 0 ),
+	m_list_size( 0 ),
+	m_list_sel( 0 ),
 	m_scripted( true ),
 	m_custom_sel( -1 )
 {
@@ -44,6 +59,7 @@ FeListBox::FeListBox( FePresentableParent &p, int x, int y, int w, int h )
 	m_base_text.setSize( sf::Vector2f( w, h ) );
 	m_base_text.setColor( sf::Color::White );
 	m_base_text.setBgColor( sf::Color::Transparent );
+	set_template();
 }
 
 FeListBox::FeListBox(
@@ -65,9 +81,21 @@ FeListBox::FeListBox(
 	m_filter_offset( 0 ),
 	m_rotation( 0.0 ),
 	m_scale_factor( 1.0 ),
+	m_list_filter_index( 0 ),
+	m_list_size( 0 ),
+	m_list_sel( 0 ),
 	m_scripted( false ),
 	m_custom_sel( -1 )
 {
+	set_template();
+}
+
+void FeListBox::set_template()
+{
+	if ( m_format_string.empty() )
+		m_template.compile( "[Title]" );
+	else
+		m_template.compile( m_format_string );
 }
 
 void FeListBox::setFont( const sf::Font &f )
@@ -331,40 +359,95 @@ void FeListBox::setRotation( float r )
 		FePresent::script_flag_redraw();
 }
 
-void FeListBox::on_new_list( FeSettings *s )
+const std::string &FeListBox::get_row_text( FeSettings *s,
+	const int index,
+	const int sel )
 {
-	init_dimensions();
+	std::map<int, std::string>::iterator itr = m_row_cache.find( index );
+	if ( itr != m_row_cache.end() )
+		return itr->second;
 
-	if ( m_custom_sel >= 0 )
+	std::string &row = m_row_cache[ index ];
+
+	if ( m_template.has_magic() )
 	{
-		internalSetText( m_custom_sel );
-		return;
+		FePresent::script_process_magic_strings(
+			m_template, row, m_filter_offset, index - sel );
+
+		s->do_text_substitutions_absolute(
+			row, m_list_filter_index, index );
 	}
+	else
+		s->do_text_substitutions_absolute(
+			m_template, row, m_list_filter_index, index );
+
+	return row;
+}
 
-	int filter_index = s->get_filter_index_from_offset( m_filter_offset );
-	int filter_size = s->get_filter_size( filter_index );
-	int current_sel = s->get_rom_index( filter_index, 0 );
+void FeListBox::internalSetRows( FeSettings *s, const int index )
+{
+	int offset = index - ( (int)m_texts.size() / 2 );
+	int first = std::max( 0, offset - ROW_MARGIN );
+	int last = std::min( m_list_size, offset + (int)m_texts.size() + ROW_MARGIN );
 
-	m_displayList.clear();
-	m_displayList.reserve( filter_size );
+	//
+	// Magic token functions are passed the row's offset from the selection,
+	// so rows formatted with them are only good for the selection they were
+	// formatted for
+	//
+	bool magic = m_template.has_magic();
+	if ( magic && ( index != m_list_sel ))
+		m_row_cache.clear();
 
-	std::string format_string = m_format_string;
-	if ( format_string.empty() )
-		format_string = "[Title]";
+	m_list_sel = index;
 
-	for ( int i=0; i < filter_size; i++ )
+	//
+	// Trim the cache back to the rows around the selection once it has
+	// grown too large.  This keeps the cost bounded by the number of rows
+	// rather than by the size of the list
+	//
+	if ( (int)m_row_cache.size() > ROW_CACHE_MAX )
 	{
-		m_displayList.push_back( format_string );
+		m_row_cache.erase( m_row_cache.begin(),
+			m_row_cache.lower_bound( first ) );
+		m_row_cache.erase( m_row_cache.lower_bound( last ),
+			m_row_cache.end() );
+	}
 
-		FePresent::script_process_magic_strings(
-			m_displayList.back(),
-			m_filter_offset, i - current_sel );
+	for ( int i=0; i < (int)m_texts.size(); i++ )
+	{
+		int listentry = offset + i;
+		if (( listentry < 0 ) || ( listentry >= m_list_size ))
+			m_texts[i].setString("");
+		else
+			m_texts[i].setString( get_row_text( s, listentry, index ) );
+	}
 
-		s->do_text_substitutions_absolute(
-			m_displayList.back(), filter_index, i );
+	// Format the margin rows now so that scrolling by a row or a page
+	// only ever has to look up text that is already in the cache
+	if ( !magic )
+	{
+		for ( int i=first; i < last; i++ )
+			get_row_text( s, i, index );
 	}
+}
 
-	internalSetText( current_sel );
+void FeListBox::on_new_list( FeSettings *s )
+{
+	init_dimensions();
+
+	if ( m_custom_sel >= 0 )
+	{
+		internalSetText( m_custom_sel );
+		return;
+	}
+
+	m_list_filter_index = s->get_filter_index_from_offset( m_filter_offset );
+	m_list_size = s->get_filter_size( m_list_filter_index );
+	m_list_sel = s->get_rom_index( m_list_filter_index, 0 );
+
+	m_row_cache.clear();
+	internalSetRows( s, m_list_sel );
 }
 
 void FeListBox::on_new_selection( FeSettings *s )
@@ -372,10 +455,8 @@ void FeListBox::on_new_selection( FeSettings *s )
 	if ( m_custom_sel >= 0 )
 		internalSetText( m_custom_sel );
 	else
-		internalSetText(
-			s->get_rom_index(
-				s->get_filter_index_from_offset(
-					m_filter_offset ), 0 ) );
+		internalSetRows( s,
+			s->get_rom_index( m_list_filter_index, 0 ) );
 }
 
 void FeListBox::set_scale_factor( float scale_x, float scale_y )
@@ -471,7 +552,10 @@ int FeListBox::get_rows()
 
 int FeListBox::get_list_size()
 {
-	return m_displayList.size();
+	if ( m_custom_sel >= 0 )
+		return m_displayList.size();
+
+	return m_list_size;
 }
 
 int FeListBox::get_style()
@@ -769,6 +853,7 @@ const char *FeListBox::get_format_string()
 void FeListBox::set_format_string( const char *s )
 {
 	m_format_string = s;
+	set_template();
 
 	if ( m_scripted )
 		FePresent::script_do_update( this );
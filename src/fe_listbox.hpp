@@ -24,8 +24,10 @@
 #define FE_LISTBOX_HPP
 
 #include <SFML/Graphics.hpp>
+#include <map>
 #include "fe_presentable.hpp"
 #include "tp.hpp"
+#include "text_template.hpp"
 
 class FeSettings;
 class FePresent;
@@ -155,12 +157,18 @@ private:
 	FeListBox &operator=( const FeListBox & );
 
 	void internalSetText( const int index );
+	void set_template();
+	void internalSetRows( FeSettings *s, const int index );
+	const std::string &get_row_text( FeSettings *s,
+		const int index,
+		const int sel );
 
 	FeTextPrimative m_base_text;
 	std::vector<std::string> m_displayList;
 	std::vector<FeTextPrimative> m_texts;
 	std::string m_font_name;
 	std::string m_format_string;
+	FeTextTemplate m_template;	// m_format_string, parsed for substitutions
 	sf::Color m_selColour;
 	sf::Color m_selBg;
 	int m_selStyle;
@@ -169,6 +177,15 @@ private:
 	int m_filter_offset;
 	float m_rotation;
 	float m_scale_factor;
+
+	// Game list rows are formatted on demand (for the visible rows plus a
+	// margin) and kept in m_row_cache, which is trimmed back to the area
+	// around the current selection whenever it grows past its limit
+	std::map<int, std::string> m_row_cache;
+	int m_list_filter_index;
+	int m_list_size;
+	int m_list_sel; // the selection that m_row_cache was last filled for
+
 	bool m_scripted;
 
 	// this contains the custom selection index, if custom text has been
@@ -29,6 +29,7 @@
 #include "fe_file.hpp"
 #include "fe_blend.hpp"
 #include "zip.hpp"
+#include "image_loader.hpp"
 
 #include <iostream>
 #include <cmath>
@@ -798,6 +799,12 @@ void FePresent::change_selection( int step, bool end_navigation )
 		m_feSettings->step_current_selection( step );
 		update( false );
 
+		// start on the artwork for where the selection is heading
+		FeImageLoader::get_ref().clear_prefetch();
+		for ( std::vector<FeBaseTextureContainer *>::iterator itc=m_texturePool.begin();
+				itc != m_texturePool.end(); ++itc )
+			(*itc)->prefetch( m_feSettings, step );
+
 		on_transition( FromOldSelection, -step );
 
 		if ( end_navigation )
@@ -1386,6 +1393,11 @@ const char *FePresent::get_search_rule()
 	return m_feSettings->get_search_rule().c_str();
 }
 
+int FePresent::type_ahead( const char *s )
+{
+	return m_feSettings->type_ahead( s );
+}
+
 void FePresent::set_preserve_aspect_ratio( bool p )
 {
 	if ( p != m_preserve_aspect )
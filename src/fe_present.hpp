@@ -183,6 +183,7 @@ protected:
 	int get_list_limit() const;
 	void set_search_rule( const char * );
 	const char *get_search_rule();
+	int type_ahead( const char * );
 	bool get_preserve_aspect_ratio();
 
 	void set_selection_index( int );
@@ -261,6 +262,10 @@ public:
 	static void script_process_magic_strings( std::string &str,
 			int filter_offset,
 			int index_offset );
+	static void script_process_magic_strings( const FeTextTemplate &t,
+			std::string &out,
+			int filter_offset,
+			int index_offset );
 	static std::string script_get_base_path();
 
 	//
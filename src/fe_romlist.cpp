@@ -26,16 +26,19 @@
 #include <iostream>
 #include "nowide/fstream.hpp"
 #include <algorithm>
+#include <cctype>
 
 #include <squirrel.h>
 #include <sqstdstring.h>
 
 #include <SFML/System/Clock.hpp>
+#include <SFML/System/Thread.hpp>
 
 const char *FE_ROMLIST_FILE_EXTENSION	= ".txt";
 const char *FE_FAVOURITE_FILE_EXTENSION = ".tag";
 
 SQRex *FeRomListSorter::m_rex = NULL;
+std::string FeRomListSorter::m_rex_mask;
 
 void FeRomListSorter::init_title_rex( const std::string &re_mask )
 {
@@ -51,6 +54,8 @@ void FeRomListSorter::init_title_rex( const std::string &re_mask )
 	if ( !m_rex )
 		FeLog() << "Error compiling regular expression \""
 			<< re_mask << "\": " << err << std::endl;
+	else
+		m_rex_mask = re_mask;
 }
 
 void FeRomListSorter::clear_title_rex()
@@ -59,6 +64,7 @@ void FeRomListSorter::clear_title_rex()
 		sqstd_rex_free( m_rex );
 
 	m_rex = NULL;
+	m_rex_mask.clear();
 }
 
 FeRomListSorter::FeRomListSorter( FeRomInfo::Index c, bool rev )
@@ -67,19 +73,16 @@ FeRomListSorter::FeRomListSorter( FeRomInfo::Index c, bool rev )
 {
 }
 
-bool FeRomListSorter::operator()( const FeRomInfo &one_obj, const FeRomInfo &two_obj ) const
+void FeRomListSorter::get_key( const std::string &value, Key &key ) const
 {
-	const std::string &one = one_obj.get_info( m_comp );
-	const std::string &two = two_obj.get_info( m_comp );
+	key.str = &value;
+	key.begin = 0;
+	key.num = 0;
 
 	if (( m_comp == FeRomInfo::Title ) && m_rex )
 	{
-		size_t one_begin( 0 ), one_len( one.size() ), two_begin( 0 ), two_len( two.size() );
-
-		const SQChar *one_begin_ptr( NULL );
-		const SQChar *one_end_ptr( NULL );
-		const SQChar *two_begin_ptr( NULL );
-		const SQChar *two_end_ptr( NULL );
+		const SQChar *begin_ptr( NULL );
+		const SQChar *end_ptr( NULL );
 
 		//
 		// I couldn't get Squirrel's no capture regexp (?:) working the way I would expect it to.
@@ -88,30 +91,42 @@ bool FeRomListSorter::operator()( const FeRomInfo &one_obj, const FeRomInfo &two
 		// So we do this kind of backwards, instead of defining what we want to compare based on,
 		// the regexp instead defines the part of the string we want to strip out up front
 		//
-		if ( sqstd_rex_search( m_rex, one.c_str(), &one_begin_ptr, &one_end_ptr ) == SQTrue )
-		{
-			one_begin = one_end_ptr - one.c_str();
-			one_len -= one_begin;
-		}
-
-		if ( sqstd_rex_search( m_rex, two.c_str(), &two_begin_ptr, &two_end_ptr ) == SQTrue )
-		{
-			two_begin = two_end_ptr - two.c_str();
-			two_len -= two_begin;
-		}
+		if ( sqstd_rex_search( m_rex, value.c_str(), &begin_ptr, &end_ptr ) == SQTrue )
+			key.begin = end_ptr - value.c_str();
+	}
+	else if (( m_comp == FeRomInfo::PlayedCount )
+				|| ( m_comp == FeRomInfo::PlayedTime ))
+	{
+		key.num = as_int( value );
+	}
+}
 
-		return ( one.compare( one_begin, one_len, two, two_begin, two_len ) < 0 );
+bool FeRomListSorter::less( const Key &one, const Key &two ) const
+{
+	if (( m_comp == FeRomInfo::Title ) && m_rex )
+	{
+		return ( one.str->compare( one.begin, one.str->size() - one.begin,
+			*two.str, two.begin, two.str->size() - two.begin ) < 0 );
 	}
 	else if (( m_comp == FeRomInfo::PlayedCount )
 				|| ( m_comp == FeRomInfo::PlayedTime ))
 	{
-		return ( as_int( one ) > as_int( two ) );
+		return ( one.num > two.num );
 	}
 
 	if ( m_reverse )
-		return ( one.compare( two ) > 0 );
+		return ( one.str->compare( *two.str ) > 0 );
 	else
-		return ( one.compare( two ) < 0 );
+		return ( one.str->compare( *two.str ) < 0 );
+}
+
+bool FeRomListSorter::operator()( const FeRomInfo &one_obj, const FeRomInfo &two_obj ) const
+{
+	Key one, two;
+	get_key( one_obj.get_info( m_comp ), one );
+	get_key( two_obj.get_info( m_comp ), two );
+
+	return less( one, two );
 }
 
 const char FeRomListSorter::get_first_letter( const FeRomInfo *one_info )
@@ -136,8 +151,350 @@ const char FeRomListSorter::get_first_letter( const FeRomInfo *one_info )
 	return name.at( b );
 }
 
+namespace
+{
+	//
+	// Orders value ids by their precomputed sort keys
+	//
+	class FeKeyIdLess
+	{
+	public:
+		FeKeyIdLess( const FeRomListSorter &s,
+				const std::vector< FeRomListSorter::Key > &keys )
+			: m_sorter( s ), m_keys( keys )
+		{
+		};
+
+		bool operator()( sf::Uint32 one, sf::Uint32 two ) const
+		{
+			return m_sorter.less( m_keys[one], m_keys[two] );
+		};
+
+	private:
+		const FeRomListSorter &m_sorter;
+		const std::vector< FeRomListSorter::Key > &m_keys;
+	};
+};
+
+const std::vector< sf::Uint32 > &FeSortRankCache::get_ranks( FeRomInfo::Index c, bool rev )
+{
+	Ranks &r = m_ranks[ std::pair< int, bool >( c, rev ) ];
+
+	sf::Uint32 generation = FeRomInfo::get_column_generation( c );
+	const std::string &rex_mask = ( c == FeRomInfo::Title )
+		? FeRomListSorter::get_title_rex_mask() : std::string();
+
+	if (( !r.ranks.empty() )
+			&& ( r.generation == generation )
+			&& ( r.rex_mask.compare( rex_mask ) == 0 ))
+		return r.ranks;
+
+	//
+	// Compute the sort key for each value once, then order the values
+	//
+	FeRomListSorter sorter( c, rev );
+	sf::Uint32 size = FeRomInfo::get_column_size( c );
+
+	std::vector< FeRomListSorter::Key > keys( size );
+	std::vector< sf::Uint32 > order( size );
+
+	for ( sf::Uint32 id=0; id<size; id++ )
+	{
+		sorter.get_key( FeRomInfo::get_column_value( c, id ), keys[id] );
+		order[id] = id;
+	}
+
+	std::sort( order.begin(), order.end(), FeKeyIdLess( sorter, keys ) );
+
+	r.ranks.resize( size );
+	r.ranks[ order[0] ] = 0;
+
+	for ( sf::Uint32 i=1; i<size; i++ )
+	{
+		r.ranks[ order[i] ] = r.ranks[ order[i-1] ]
+			+ ( sorter.less( keys[ order[i-1] ], keys[ order[i] ] ) ? 1 : 0 );
+	}
+
+	r.generation = generation;
+	r.rex_mask = rex_mask;
+	return r.ranks;
+}
+
+FeNavIndex::FeNavIndex()
+	: m_fav_serial( 0 ),
+	m_letters_built( false ),
+	m_favs_built( false )
+{
+}
+
+void FeNavIndex::clear()
+{
+	m_run_starts.clear();
+	m_run_letters.clear();
+	m_alpha_runs.clear();
+	m_favs.clear();
+	m_letters_built = false;
+	m_favs_built = false;
+}
+
+void FeNavIndex::build_letters( const std::vector< FeRomInfo * > &list )
+{
+	FeRomListSorter s;
+
+	m_run_starts.clear();
+	m_run_letters.clear();
+	m_alpha_runs.clear();
+
+	for ( int i=0; i<(int)list.size(); i++ )
+	{
+		const char l = s.get_first_letter( list[i] );
+		if (( !m_run_letters.empty() ) && ( m_run_letters.back() == l ))
+			continue;
+
+		if ( std::isalpha( l ) )
+			m_alpha_runs.push_back( m_run_starts.size() );
+
+		m_run_starts.push_back( i );
+		m_run_letters.push_back( l );
+	}
+
+	m_letters_built = true;
+}
+
+void FeNavIndex::build_favs( const std::vector< FeRomInfo * > &list )
+{
+	m_favs.clear();
+
+	for ( int i=0; i<(int)list.size(); i++ )
+	{
+		if ( list[i]->get_info( FeRomInfo::Favourite ).compare( "1" ) == 0 )
+			m_favs.push_back( i );
+	}
+
+	m_favs_built = true;
+}
+
+int FeNavIndex::get_letter_offset( const std::vector< FeRomInfo * > &list,
+	int idx, int step )
+{
+	int size = list.size();
+	if (( size < 2 ) || ( idx < 0 ) || ( idx >= size ))
+		return 0;
+
+	if ( !m_letters_built )
+		build_letters( list );
+
+	int runs = m_run_starts.size();
+	int run = std::upper_bound( m_run_starts.begin(), m_run_starts.end(), idx )
+		- m_run_starts.begin() - 1;
+
+	const char curr_l = m_run_letters[run];
+	int target = -1;
+
+	if ( std::isalpha( curr_l ) )
+	{
+		//
+		// Jump to the entry with a different letter.  Runs next to each
+		// other always have different letters
+		//
+		if ( step > 0 )
+		{
+			if ( run + 1 < runs )
+				target = m_run_starts[run+1];
+			else if ( m_run_letters[0] != curr_l )
+				target = 0;
+			else if ( runs > 1 )
+				target = m_run_starts[1];
+		}
+		else
+		{
+			if ( run > 0 )
+				target = m_run_starts[run] - 1;
+			else if ( m_run_letters[runs-1] != curr_l )
+				target = size - 1;
+			else if ( runs > 1 )
+				target = m_run_starts[runs-1] - 1;
+		}
+	}
+	else if ( !m_alpha_runs.empty() )
+	{
+		//
+		// Jump to the nearest entry with an alphabetic letter
+		//
+		if ( step > 0 )
+		{
+			std::vector< int >::iterator itr = std::upper_bound(
+				m_alpha_runs.begin(), m_alpha_runs.end(), run );
+
+			target = m_run_starts[ ( itr != m_alpha_runs.end() ) ? *itr : m_alpha_runs.front() ];
+		}
+		else
+		{
+			std::vector< int >::iterator itr = std::lower_bound(
+				m_alpha_runs.begin(), m_alpha_runs.end(), run );
+
+			int r = ( itr != m_alpha_runs.begin() ) ? *( itr - 1 ) : m_alpha_runs.back();
+			target = ( r + 1 < runs ) ? m_run_starts[r+1] - 1 : size - 1;
+		}
+	}
+
+	return ( target < 0 ) ? 0 : ( target - idx );
+}
+
+int FeNavIndex::get_fav_offset( const std::vector< FeRomInfo * > &list,
+	int idx, int step, sf::Uint32 fav_serial )
+{
+	if (( !m_favs_built ) || ( m_fav_serial != fav_serial ))
+	{
+		build_favs( list );
+		m_fav_serial = fav_serial;
+	}
+
+	if ( m_favs.empty() )
+		return 0;
+
+	int target;
+	if ( step > 0 )
+	{
+		std::vector< int >::iterator itr = std::upper_bound(
+			m_favs.begin(), m_favs.end(), idx );
+
+		target = ( itr != m_favs.end() ) ? *itr : m_favs.front();
+	}
+	else
+	{
+		std::vector< int >::iterator itr = std::lower_bound(
+			m_favs.begin(), m_favs.end(), idx );
+
+		target = ( itr != m_favs.begin() ) ? *( itr - 1 ) : m_favs.back();
+	}
+
+	return ( target - idx );
+}
+
+FeRomNameIndex::FeRomNameIndex()
+	: m_built( false )
+{
+}
+
+void FeRomNameIndex::build( FeRomInfoListType &list )
+{
+	clear();
+
+	m_heads.resize( FeRomInfo::get_column_size( FeRomInfo::Romname ), 0 );
+
+	// track the last slot of each chain so the chains end up in list order
+	std::vector< sf::Uint32 > tails( m_heads.size(), 0 );
+
+	for ( FeRomInfoListType::iterator itr=list.begin(); itr!=list.end(); ++itr )
+	{
+		sf::Uint32 id = (*itr).get_info_id( FeRomInfo::Romname );
+		sf::Uint32 slot = new_slot( itr );
+
+		if ( tails[id] )
+			m_slots[ tails[id] ].next = slot;
+		else
+			m_heads[id] = slot;
+
+		tails[id] = slot;
+	}
+
+	m_built = true;
+}
+
+void FeRomNameIndex::clear()
+{
+	m_heads.clear();
+	m_slots.clear();
+	m_free.clear();
+	m_built = false;
+}
+
+void FeRomNameIndex::find( const std::string &name, std::vector< Entry > &result ) const
+{
+	result.clear();
+
+	sf::Uint32 id;
+	if ( !FeRomInfo::find_column_id( FeRomInfo::Romname, name, id )
+			|| ( id >= m_heads.size() ))
+		return;
+
+	for ( sf::Uint32 slot=m_heads[id]; slot; slot=m_slots[slot].next )
+		result.push_back( m_slots[slot].entry );
+}
+
+void FeRomNameIndex::insert( Entry e )
+{
+	if ( !m_built )
+		return;
+
+	sf::Uint32 id = (*e).get_info_id( FeRomInfo::Romname );
+	if ( id >= m_heads.size() )
+		m_heads.resize( FeRomInfo::get_column_size( FeRomInfo::Romname ), 0 );
+
+	sf::Uint32 slot = new_slot( e );
+
+	if ( m_heads[id] )
+	{
+		sf::Uint32 last = m_heads[id];
+		while ( m_slots[last].next )
+			last = m_slots[last].next;
+
+		m_slots[last].next = slot;
+	}
+	else
+		m_heads[id] = slot;
+}
+
+void FeRomNameIndex::erase( Entry e )
+{
+	if ( !m_built )
+		return;
+
+	sf::Uint32 id = (*e).get_info_id( FeRomInfo::Romname );
+	if ( id >= m_heads.size() )
+		return;
+
+	sf::Uint32 *link = &( m_heads[id] );
+	while ( *link )
+	{
+		sf::Uint32 slot = *link;
+		if ( m_slots[slot].entry == e )
+		{
+			*link = m_slots[slot].next;
+			m_free.push_back( slot );
+			return;
+		}
+
+		link = &( m_slots[slot].next );
+	}
+}
+
+sf::Uint32 FeRomNameIndex::new_slot( Entry e )
+{
+	Slot s;
+	s.entry = e;
+	s.next = 0;
+
+	if ( !m_free.empty() )
+	{
+		sf::Uint32 slot = m_free.back();
+		m_free.pop_back();
+		m_slots[slot] = s;
+		return slot;
+	}
+
+	if ( m_slots.empty() )
+		m_slots.push_back( s ); // slot 0 is never used
+
+	m_slots.push_back( s );
+	return m_slots.size() - 1;
+}
+
 FeRomList::FeRomList( const std::string &config_path )
-	: m_global_filter_ptr( NULL ),
+	: m_lazy_display( NULL ),
+	m_global_filter_ptr( NULL ),
+	m_fav_serial( 0 ),
 	m_config_path( config_path ),
 	m_fav_changed( false ),
 	m_tags_changed( false ),
@@ -154,8 +511,15 @@ void FeRomList::init_as_empty_list()
 	m_user_path.clear();
 	m_romlist_name.clear();
 	m_list.clear();
+	m_name_index.clear();
+	m_search_index.clear();
+	m_stats.close();
 	m_filtered_list.clear();
 	m_filtered_list.push_back( std::vector< FeRomInfo *>()  ); // there always has to be at least one filter
+	m_filter_nav.clear();
+	m_filter_nav.resize( 1 );
+	m_lazy_filters.clear();
+	m_lazy_display = NULL;
 	m_tags.clear();
 	m_availability_checked = false;
 	m_fav_changed=false;
@@ -168,6 +532,7 @@ void FeRomList::init_as_empty_list()
 
 void FeRomList::mark_favs_and_tags_changed()
 {
+	m_fav_serial++;
 	m_fav_changed=true;
 	m_tags_changed=true;
 }
@@ -182,6 +547,9 @@ bool FeRomList::load_romlist( const std::string &path,
 	m_romlist_name = romlist_name;
 
 	m_list.clear();
+	m_name_index.clear();
+	m_search_index.clear();
+	m_stats.close();
 	m_availability_checked = false;
 
 	m_global_filter_ptr = NULL;
@@ -206,16 +574,45 @@ bool FeRomList::load_romlist( const std::string &path,
 
 	sf::Clock load_timer;
 
-	bool retval = FeBaseConfigurable::load_from_file(
-			path + m_romlist_name + FE_ROMLIST_FILE_EXTENSION, ";" );
+	//
+	// Use the binary romlist cache if it is up to date, otherwise parse the
+	// romlist text file and rebuild the cache as we go
+	//
+	std::string list_file = path + m_romlist_name + FE_ROMLIST_FILE_EXTENSION;
+	std::string cache_file = path + m_romlist_name + FE_ROMLIST_CACHE_EXTENSION;
+	bool retval;
+
+	if ( m_cache.open( list_file, cache_file ) )
+	{
+		FeDebug() << "Loading romlist from cache: " << cache_file << std::endl;
+
+		for ( int i=0; i<m_cache.size(); i++ )
+		{
+			FeRomInfo next_rom;
+			m_cache.get_entry( i, next_rom );
+			add_loaded_rom( next_rom );
+		}
+
+		m_cache.close();
+		retval = true;
+	}
+	else
+	{
+		m_cache.begin_build();
+		retval = FeBaseConfigurable::load_from_file( list_file, ";" );
+
+		if ( retval )
+			m_cache.save( list_file, cache_file );
+		else
+			m_cache.close();
+	}
 
 	//
-	// Create rom name to romlist entry lookup map
+	// Index the list by rom name.  The index is kept for as long as this
+	// list is loaded
 	//
-	std::map < std::string, FeRomInfo * > rom_map;
-	std::map < std::string, FeRomInfo * >::iterator rm_itr;
-	for ( FeRomInfoListType::iterator itr = m_list.begin(); itr != m_list.end(); ++itr )
-		rom_map[ (*itr).get_info( FeRomInfo::Romname ) ] = &(*itr);
+	m_name_index.build( m_list );
+	std::vector< FeRomNameIndex::Entry > matches;
 
 	//
 	// Load favourites
@@ -238,9 +635,10 @@ bool FeRomList::load_romlist( const std::string &path,
 
 			if ( !name.empty() )
 			{
-				rm_itr = rom_map.find( name );
-				if ( rm_itr != rom_map.end() )
-					(*rm_itr).second->set_info( FeRomInfo::Favourite, "1" );
+				// if more than one entry has the name, the last one gets it
+				m_name_index.find( name, matches );
+				if ( !matches.empty() )
+					(*matches.back()).set_info( FeRomInfo::Favourite, "1" );
 				else
 					m_extra_favs.insert( name );
 			}
@@ -285,9 +683,9 @@ bool FeRomList::load_romlist( const std::string &path,
 
 				if ( !rname.empty() )
 				{
-					rm_itr = rom_map.find( rname );
-					if ( rm_itr != rom_map.end() )
-						(*rm_itr).second->append_tag( (*itt).first.c_str() );
+					m_name_index.find( rname, matches );
+					if ( !matches.empty() )
+						(*matches.back()).append_tag( (*itt).first.c_str() );
 					else
 						m_extra_tags.insert( std::pair<std::string,const char*>(rname, (*itt).first.c_str() ) );
 				}
@@ -303,13 +701,17 @@ bool FeRomList::load_romlist( const std::string &path,
 		if ( first_filter->test_for_target( FeRomInfo::FileIsAvailable ) )
 			get_file_availability();
 
+		bool erased=false;
 		FeRomInfoListType::iterator last_it=m_list.begin();
 		for ( FeRomInfoListType::iterator it=m_list.begin(); it!=m_list.end(); )
 		{
 			if ( first_filter->apply_filter( *it ) )
 			{
 				if ( last_it != it )
+				{
 					it = m_list.erase( last_it, it );
+					erased = true;
+				}
 				else
 					++it;
 
@@ -352,7 +754,13 @@ bool FeRomList::load_romlist( const std::string &path,
 		}
 
 		if ( last_it != m_list.end() )
+		{
 			m_list.erase( last_it, m_list.end() );
+			erased = true;
+		}
+
+		if ( erased )
+			m_name_index.build( m_list );
 	}
 
 	//
@@ -360,8 +768,10 @@ bool FeRomList::load_romlist( const std::string &path,
 	//
 	if ( !stat_path.empty() )
 	{
+		m_stats.open( stat_path, m_romlist_name );
+
 		for ( FeRomInfoListType::iterator it=m_list.begin(); it!=m_list.end(); ++it )
-			(*it).load_stats( stat_path );
+			(*it).load_stats( m_stats );
 	}
 
 	FeLog() << " - Loaded master romlist '" << m_romlist_name
@@ -373,29 +783,65 @@ bool FeRomList::load_romlist( const std::string &path,
 	return retval;
 }
 
-void FeRomList::build_single_filter_list( FeFilter *f,
-	std::vector< FeRomInfo *> &result )
+namespace
 {
-	if ( f )
+//
+// Stable sort of "list" by the rank of each entry's "c" attribute value.
+// This is a least significant digit radix sort, one pass for each byte of
+// the largest rank
+//
+void sort_by_rank( std::vector< FeRomInfo *> &list,
+	FeRomInfo::Index c,
+	const std::vector< sf::Uint32 > &ranks )
+{
+	typedef std::pair< sf::Uint32, FeRomInfo * > RankedEntry;
+
+	size_t n = list.size();
+	std::vector< RankedEntry > a( n );
+	std::vector< RankedEntry > b( n );
+
+	sf::Uint32 max_rank = 0;
+	for ( size_t i=0; i<n; i++ )
 	{
-		if ( f->get_size() > 0 ) // if this is non zero then we've loaded before and know how many to expect
-			result.reserve( f->get_size() );
+		sf::Uint32 id = list[i]->get_info_id( c );
+		ASSERT( id < ranks.size() );
 
-		if ( f->test_for_target( FeRomInfo::FileIsAvailable ) )
-			get_file_availability();
+		a[i].first = ranks[id];
+		a[i].second = list[i];
 
-		f->init();
-		for ( FeRomInfoListType::iterator itr=m_list.begin(); itr!=m_list.end(); ++itr )
-			if ( f->apply_filter( *itr ) )
-				result.push_back( &( *itr ) );
+		if ( a[i].first > max_rank )
+			max_rank = a[i].first;
 	}
-	else // no filter situation, so we just add the entire list...
+
+	for ( int shift=0; ( shift < 32 ) && (( max_rank >> shift ) != 0 ); shift += 8 )
 	{
-		result.reserve( m_list.size() );
-		for ( FeRomInfoListType::iterator itr=m_list.begin(); itr!=m_list.end(); ++itr )
-			result.push_back( &( *itr ) );
+		size_t count[257] = { 0 };
+
+		for ( size_t i=0; i<n; i++ )
+			count[ (( a[i].first >> shift ) & 0xFF ) + 1 ]++;
+
+		for ( int i=1; i<257; i++ )
+			count[i] += count[i-1];
+
+		for ( size_t i=0; i<n; i++ )
+			b[ count[ ( a[i].first >> shift ) & 0xFF ]++ ] = a[i];
+
+		a.swap( b );
 	}
 
+	for ( size_t i=0; i<n; i++ )
+		list[i] = a[i].second;
+}
+
+//
+// Sort and prune "result" once it has been filled with the entries that
+// pass filter "f".  "ranks" is the sorted order of the filter's sort
+// attribute (NULL if it isn't sorted)
+//
+void finish_filter_list( FeFilter *f,
+	std::vector< FeRomInfo *> &result,
+	const std::vector< sf::Uint32 > *ranks )
+{
 	if ( f )
 	{
 		// track the size of the filtered list in our filter info object
@@ -410,8 +856,8 @@ void FeRomList::build_single_filter_list( FeFilter *f,
 
 		if ( sort_by != FeRomInfo::LAST_INDEX )
 		{
-			std::stable_sort( result.begin(), result.end(),
-				FeRomListSorter2( sort_by, rev ) );
+			ASSERT( ranks );
+			sort_by_rank( result, sort_by, *ranks );
 		}
 		else if ( rev != false )
 			std::reverse( result.begin(), result.end() );
@@ -426,6 +872,135 @@ void FeRomList::build_single_filter_list( FeFilter *f,
 	}
 }
 
+//
+// A set of filters built together by one thread in create_filters()
+//
+struct FeFilterGroup
+{
+	FeRomInfoListType *list;
+	std::vector< FeFilter * > filters;
+	std::vector< std::vector< FeRomInfo * > * > results;
+	std::vector< const std::vector< sf::Uint32 > * > ranks;
+};
+
+void build_filter_group( FeFilterGroup *g )
+{
+	//
+	// Build all of the group's filters in a single pass through the list
+	//
+	for ( FeRomInfoListType::iterator itr=g->list->begin(); itr!=g->list->end(); ++itr )
+	{
+		for ( unsigned int i=0; i<g->filters.size(); i++ )
+		{
+			if (( !g->filters[i] ) || ( g->filters[i]->apply_filter( *itr ) ))
+				g->results[i]->push_back( &( *itr ) );
+		}
+	}
+
+	for ( unsigned int i=0; i<g->filters.size(); i++ )
+		finish_filter_list( g->filters[i], *(g->results[i]), g->ranks[i] );
+}
+};
+
+void FeRomList::build_single_filter_list( FeFilter *f,
+	std::vector< FeRomInfo *> &result )
+{
+	begin_filter_list( f, result );
+
+	if ( f )
+	{
+		for ( FeRomInfoListType::iterator itr=m_list.begin(); itr!=m_list.end(); ++itr )
+			if ( f->apply_filter( *itr ) )
+				result.push_back( &( *itr ) );
+	}
+	else // no filter situation, so we just add the entire list...
+	{
+		for ( FeRomInfoListType::iterator itr=m_list.begin(); itr!=m_list.end(); ++itr )
+			result.push_back( &( *itr ) );
+	}
+
+	finish_filter_list( f, result, get_sort_ranks( f ) );
+}
+
+const std::vector< sf::Uint32 > *FeRomList::get_sort_ranks( FeFilter *f )
+{
+	if (( !f ) || ( f->get_sort_by() == FeRomInfo::LAST_INDEX ))
+		return NULL;
+
+	return &m_sort_ranks.get_ranks( f->get_sort_by(), f->get_reverse_order() );
+}
+
+void FeRomList::begin_filter_list( FeFilter *f,
+	std::vector< FeRomInfo *> &result )
+{
+	if ( f )
+	{
+		if ( f->get_size() > 0 ) // if this is non zero then we've loaded before and know how many to expect
+			result.reserve( f->get_size() );
+
+		if ( f->test_for_target( FeRomInfo::FileIsAvailable ) )
+			get_file_availability();
+
+		f->init();
+	}
+	else
+		result.reserve( m_list.size() );
+}
+
+void FeRomList::build_filters( FeDisplayInfo &display,
+	const std::vector< int > &indices )
+{
+	if ( indices.empty() )
+		return;
+
+	//
+	// Once prepared, the filters are independent of each other, so they
+	// get divided up between threads.  Each filter (and its rules) is only
+	// ever used by one thread and the results keep the same order as
+	// building them one by one.
+	//
+	int group_count = std::min( (int)indices.size(), get_processor_count() );
+	std::vector< FeFilterGroup > groups( group_count );
+
+	for ( unsigned int i=0; i<indices.size(); i++ )
+	{
+		FeFilter *f = display.get_filter( indices[i] );
+		std::vector< FeRomInfo * > &result = m_filtered_list[ indices[i] ];
+
+		result.clear();
+		m_filter_nav[ indices[i] ].clear();
+		begin_filter_list( f, result );
+
+		FeFilterGroup &g = groups[ i % group_count ];
+		g.filters.push_back( f );
+		g.results.push_back( &result );
+
+		// sorted orders are worked out here, so the threads only read them
+		g.ranks.push_back( get_sort_ranks( f ) );
+	}
+
+	std::vector< sf::Thread * > threads;
+	for ( int i=0; i<group_count; i++ )
+	{
+		groups[i].list = &m_list;
+
+		if ( i > 0 )
+		{
+			threads.push_back( new sf::Thread( &build_filter_group, &( groups[i] ) ) );
+			threads.back()->launch();
+		}
+	}
+
+	// the first group is built on this thread
+	build_filter_group( &( groups[0] ) );
+
+	for ( std::vector< sf::Thread * >::iterator itr=threads.begin(); itr!=threads.end(); ++itr )
+	{
+		(*itr)->wait();
+		delete (*itr);
+	}
+}
+
 void FeRomList::create_filters(
 	FeDisplayInfo &display )
 {
@@ -444,19 +1019,91 @@ void FeRomList::create_filters(
 		filters_count = 1;
 
 	m_filtered_list.clear();
-	m_filtered_list.reserve( filters_count );
+	m_filtered_list.resize( filters_count );
+	m_filter_nav.clear();
+	m_filter_nav.resize( filters_count );
+	m_lazy_filters.clear();
+
+	//
+	// Only the current filter is built now.  The others are built when
+	// they are first used (see check_filter())
+	//
+	int current = display.get_current_filter_index();
+	if (( current < 0 ) || ( current >= filters_count ))
+		current = 0;
 
 	for ( int i=0; i<filters_count; i++ )
 	{
-		m_filtered_list.push_back( std::vector< FeRomInfo *>()  );
-
-		build_single_filter_list( display.get_filter( i ),
-			m_filtered_list[i] );
+		if ( i != current )
+			m_lazy_filters.insert( i );
 	}
 
-	FeLog() << " - Constructed " << filters_count << " filters in "
+	m_lazy_display = m_lazy_filters.empty() ? NULL : &display;
+
+	build_filters( display, std::vector< int >( 1, current ) );
+
+	FeLog() << " - Constructed filter " << current << " of " << filters_count << " in "
 			<< load_timer.getElapsedTime().asMilliseconds()
-			<< " ms (" << filters_count * m_list.size() << " comparisons)" << std::endl;
+			<< " ms (" << m_list.size() << " comparisons)" << std::endl;
+}
+
+int FeRomList::get_letter_offset( int filter_idx, int idx, int step )
+{
+	check_filter( filter_idx );
+	return m_filter_nav[ filter_idx ].get_letter_offset(
+		m_filtered_list[ filter_idx ], idx, step );
+}
+
+int FeRomList::get_fav_offset( int filter_idx, int idx, int step )
+{
+	check_filter( filter_idx );
+	return m_filter_nav[ filter_idx ].get_fav_offset(
+		m_filtered_list[ filter_idx ], idx, step, m_fav_serial );
+}
+
+void FeRomList::build_lazy_filter( int filter_idx )
+{
+	std::set< int >::iterator itr = m_lazy_filters.find( filter_idx );
+	if ( itr == m_lazy_filters.end() )
+		return;
+
+	ASSERT( m_lazy_display );
+	ASSERT( filter_idx < m_lazy_display->get_filter_count() );
+
+	m_lazy_filters.erase( itr );
+
+	if (( !m_lazy_display ) || ( filter_idx >= m_lazy_display->get_filter_count() ))
+	{
+		m_filtered_list[ filter_idx ].clear();
+		m_filter_nav[ filter_idx ].clear();
+		return;
+	}
+
+	sf::Clock load_timer;
+
+	// Build from the display's own filter so that its size gets set
+	build_single_filter_list( m_lazy_display->get_filter( filter_idx ),
+		m_filtered_list[ filter_idx ] );
+
+	m_filter_nav[ filter_idx ].clear();
+
+	if ( m_lazy_filters.empty() )
+		m_lazy_display = NULL;
+
+	FeDebug() << " - Constructed filter " << filter_idx << " in "
+			<< load_timer.getElapsedTime().asMilliseconds() << " ms" << std::endl;
+}
+
+void FeRomList::build_lazy_filters( bool discard )
+{
+	if ( !discard )
+	{
+		while ( !m_lazy_filters.empty() )
+			build_lazy_filter( *m_lazy_filters.begin() );
+	}
+
+	m_lazy_filters.clear();
+	m_lazy_display = NULL;
 }
 
 int FeRomList::process_setting( const std::string &setting,
@@ -466,12 +1113,19 @@ int FeRomList::process_setting( const std::string &setting,
 	FeRomInfo next_rom( setting );
 	next_rom.process_setting( setting, value, fn );
 
-	if (( !m_global_filter_ptr ) || ( m_global_filter_ptr->apply_filter( next_rom ) ))
-		m_list.push_back( next_rom );
+	if ( m_cache.is_building() )
+		m_cache.add_entry( next_rom );
+
+	add_loaded_rom( next_rom );
+	return 0;
+}
+
+void FeRomList::add_loaded_rom( const FeRomInfo &rom )
+{
+	if (( !m_global_filter_ptr ) || ( m_global_filter_ptr->apply_filter( rom ) ))
+		m_list.push_back( rom );
 	else
 		m_global_filtered_out_count++;
-
-   return 0;
 }
 
 void FeRomList::save_state()
@@ -592,6 +1246,7 @@ bool FeRomList::set_fav( FeRomInfo &r, FeDisplayInfo &display, bool fav )
 {
 	r.set_info( FeRomInfo::Favourite, fav ? "1" : "" );
 	m_fav_changed=true;
+	m_fav_serial++;
 
 	return fix_filters( display, FeRomInfo::Favourite );
 }
@@ -675,21 +1330,20 @@ bool FeRomList::set_tag( FeRomInfo &rom, FeDisplayInfo &display, const std::stri
 
 bool FeRomList::fix_filters( FeDisplayInfo &display, FeRomInfo::Index target )
 {
-	bool retval = false;
+	std::vector< int > indices;
 	for ( int i=0; i<display.get_filter_count(); i++ )
 	{
 		FeFilter *f = display.get_filter( i );
 		ASSERT( f );
 
-		if ( f->test_for_target( target ) )
-		{
-			m_filtered_list[i].clear();
-			build_single_filter_list( f, m_filtered_list[i] );
-			retval = true;
-		}
+		// filters that haven't been built yet will pick up the change when they are
+		if (( f->test_for_target( target ) )
+				&& ( m_lazy_filters.find( i ) == m_lazy_filters.end() ))
+			indices.push_back( i );
 	}
 
-	return retval;
+	build_filters( display, indices );
+	return !indices.empty();
 }
 
 void FeRomList::get_file_availability()
@@ -698,35 +1352,86 @@ void FeRomList::get_file_availability()
 		return;
 
 	m_availability_checked = true;
+	check_name_index();
 
-	std::map<std::string,std::vector<FeRomInfo *> > emu_map;
+	//
+	// Get the emulators used in the list, using the interned emulator ids
+	//
+	std::vector< bool > seen( FeRomInfo::get_column_size( FeRomInfo::Emulator ), false );
+	std::vector< sf::Uint32 > emu_ids;
 
 	for ( FeRomInfoListType::iterator itr=m_list.begin(); itr != m_list.end(); ++itr )
-		emu_map[ ((*itr).get_info( FeRomInfo::Emulator )) ].push_back( &(*itr) );
+	{
+		sf::Uint32 id = (*itr).get_info_id( FeRomInfo::Emulator );
+		if ( !seen[id] )
+		{
+			seen[id] = true;
+			emu_ids.push_back( id );
+		}
+	}
 
 	// figure out what roms we have for each emulator
-	for ( std::map<std::string,std::vector<FeRomInfo *> >::iterator ite=emu_map.begin();
-					ite != emu_map.end(); ++ite )
+	std::vector< FeRomNameIndex::Entry > matches;
+	for ( std::vector< sf::Uint32 >::iterator ite=emu_ids.begin(); ite != emu_ids.end(); ++ite )
 	{
-		FeEmulatorInfo *emu = get_emulator( (*ite).first );
+		FeEmulatorInfo *emu = get_emulator(
+			FeRomInfo::get_column_value( FeRomInfo::Emulator, *ite ) );
+
 		if ( emu )
 		{
 			std::vector<std::string> name_vector;
 			emu->gather_rom_names( name_vector );
 
-			std::set<std::string> name_set;
 			for ( std::vector<std::string>::iterator itv=name_vector.begin(); itv!=name_vector.end(); ++itv )
-				name_set.insert( *itv );
-
-			for ( std::vector<FeRomInfo *>::iterator itp=(*ite).second.begin(); itp!=(*ite).second.end(); ++itp )
 			{
-				if ( name_set.find( (*itp)->get_info( FeRomInfo::Romname ) ) != name_set.end() )
-					(*itp)->set_info( FeRomInfo::FileIsAvailable, "1" );
+				m_name_index.find( *itv, matches );
+
+				for ( std::vector< FeRomNameIndex::Entry >::iterator itm=matches.begin(); itm!=matches.end(); ++itm )
+				{
+					if ( (**itm).get_info_id( FeRomInfo::Emulator ) == *ite )
+						(**itm).set_info( FeRomInfo::FileIsAvailable, "1" );
+				}
 			}
 		}
 	}
 }
 
+FeRomInfoListType::iterator FeRomList::find_entry( const FeRomInfo &rom )
+{
+	check_name_index();
+
+	std::vector< FeRomNameIndex::Entry > matches;
+	m_name_index.find( rom.get_info( FeRomInfo::Romname ), matches );
+
+	for ( std::vector< FeRomNameIndex::Entry >::iterator itr=matches.begin(); itr!=matches.end(); ++itr )
+	{
+		if ( (**itr).full_comparison( rom ) )
+			return *itr;
+	}
+
+	return m_list.end();
+}
+
+FeRomInfoListType::iterator FeRomList::erase_entry( FeRomInfoListType::iterator pos )
+{
+	m_name_index.erase( pos );
+	return m_list.erase( pos );
+}
+
+FeRomInfoListType::iterator FeRomList::insert_entry( FeRomInfoListType::iterator pos, const FeRomInfo &rom )
+{
+	FeRomInfoListType::iterator itr = m_list.insert( pos, rom );
+	m_name_index.insert( itr );
+	return itr;
+}
+
+void FeRomList::replace_entry( FeRomInfoListType::iterator pos, const FeRomInfo &rom )
+{
+	m_name_index.erase( pos );
+	(*pos) = rom;
+	m_name_index.insert( pos );
+}
+
 // NOTE: this function is implemented in fe_settings.cpp
 bool internal_resolve_config_file(
 	const std::string &config_path,
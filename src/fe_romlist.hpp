@@ -24,6 +24,9 @@
 #define FE_ROMLIST_HPP
 
 #include "fe_info.hpp"
+#include "romlist_cache.hpp"
+#include "stats_store.hpp"
+#include "search_index.hpp"
 
 #include <map>
 #include <set>
@@ -41,26 +44,143 @@ private:
 	FeRomInfo::Index m_comp;
 	bool m_reverse;
 	static SQRex *m_rex;
+	static std::string m_rex_mask;
 
 public:
 	FeRomListSorter( FeRomInfo::Index c = FeRomInfo::Title, bool rev=false );
 
 	bool operator()( const FeRomInfo &obj1, const FeRomInfo &obj2 ) const;
 
+	//
+	// The part of an attribute value that gets compared.  Keys can be
+	// computed once per value and then compared many times, without
+	// rerunning the title regex or reparsing numbers on every comparison
+	//
+	struct Key
+	{
+		const std::string *str;
+		size_t begin;	// start of the compared part of str (after the title regex)
+		int num;		// parsed value, for PlayedCount and PlayedTime
+	};
+
+	void get_key( const std::string &value, Key &key ) const;
+	bool less( const Key &one, const Key &two ) const;
+
 	const char get_first_letter( const FeRomInfo *one );
 
 	static void init_title_rex( const std::string & );
 	static void clear_title_rex();
+	static const std::string &get_title_rex_mask() { return m_rex_mask; };
 };
 
-class FeRomListSorter2
+//
+// The sorted order of the values of a FeRomInfo attribute, cached for each
+// (attribute, direction) that filters are sorted by.  A value's rank is its
+// position when the values are ordered by FeRomListSorter, with values that
+// compare equal sharing a rank, so lists can be sorted on the ranks alone.
+//
+// Ranks are indexed by value id (see FeRomInfo::get_info_id()) and are
+// recalculated once values are added to the attribute.
+//
+class FeSortRankCache
 {
+public:
+	const std::vector< sf::Uint32 > &get_ranks( FeRomInfo::Index c, bool rev );
+	void clear() { m_ranks.clear(); };
+
 private:
-	FeRomListSorter m_sorter;
+	struct Ranks
+	{
+		sf::Uint32 generation;
+		std::string rex_mask;
+		std::vector< sf::Uint32 > ranks;
+	};
+
+	std::map< std::pair< int, bool >, Ranks > m_ranks;
+};
 
+//
+// Jump tables for moving through a filtered list to the next letter (the
+// first letter of the title, as per FeRomListSorter::get_first_letter())
+// or to the next favourite.  The list is split into runs of entries with
+// the same first letter, so each jump is a binary search of the run starts
+// or favourite positions rather than a walk through the list.
+//
+// The tables are built the first time they are used.  clear() has to be
+// called whenever the list changes.  The favourite positions are also
+// rebuilt whenever "fav_serial" changes.
+//
+class FeNavIndex
+{
 public:
-	FeRomListSorter2( FeRomInfo::Index c = FeRomInfo::Title, bool rev=false ) : m_sorter( c, rev ) {};
-	bool operator()( const FeRomInfo *one, const FeRomInfo *two ) const { return m_sorter.operator()(*one,*two); };
+	FeNavIndex();
+
+	void clear();
+
+	// return the offset from "idx" to the next (step > 0) or previous
+	// (step < 0) entry with a different first letter, 0 if there is none
+	int get_letter_offset( const std::vector< FeRomInfo * > &list,
+		int idx, int step );
+
+	// return the offset from "idx" to the next (step > 0) or previous
+	// (step < 0) favourite, 0 if there is none
+	int get_fav_offset( const std::vector< FeRomInfo * > &list,
+		int idx, int step, sf::Uint32 fav_serial );
+
+private:
+	std::vector< int > m_run_starts;
+	std::vector< char > m_run_letters;
+	std::vector< int > m_alpha_runs; // the runs whose letter is alphabetic
+	std::vector< int > m_favs;
+	sf::Uint32 m_fav_serial;
+	bool m_letters_built;
+	bool m_favs_built;
+
+	void build_letters( const std::vector< FeRomInfo * > &list );
+	void build_favs( const std::vector< FeRomInfo * > &list );
+};
+
+//
+// Index of the entries in a FeRomInfoListType by romname.  It is keyed on
+// the interned romname ids (see FeRomInfo::get_info_id()), so a lookup is
+// one hash probe of the romname column.  Entries with the same romname are
+// chained together, in list order when the index is built.
+//
+// The index holds list iterators, so it stays valid while entries are
+// added to or erased from the list as long as it is told about them.
+//
+class FeRomNameIndex
+{
+public:
+	typedef FeRomInfoListType::iterator Entry;
+
+	FeRomNameIndex();
+
+	void build( FeRomInfoListType &list );
+	void clear();
+	bool is_built() const { return m_built; };
+
+	// put the entries with romname "name" in "result"
+	void find( const std::string &name, std::vector< Entry > &result ) const;
+
+	// keep the index up to date with the list.  erase() has to be called
+	// before the entry's romname is changed or the entry is removed
+	void insert( Entry e );
+	void erase( Entry e );
+
+private:
+	struct Slot
+	{
+		Entry entry;
+		sf::Uint32 next; // next slot in the chain, 0 for none
+	};
+
+	std::vector< sf::Uint32 > m_heads; // first slot in the chain for each romname id
+	std::vector< Slot > m_slots; // slot 0 is unused
+	std::vector< sf::Uint32 > m_free;
+	bool m_built;
+
+	sf::Uint32 new_slot( Entry e );
 };
 
 class FeRomList : public FeBaseConfigurable
@@ -68,12 +188,21 @@ class FeRomList : public FeBaseConfigurable
 private:
 	FeRomInfoListType m_list; // this is where we keep the info on all the games available for the current display
 	std::vector<std::vector<FeRomInfo * > > m_filtered_list; // for each filter, store a pointer to the m_list entries in that filter
+	std::set<int> m_lazy_filters; // indices of the filters that haven't been built in m_filtered_list yet
+	FeDisplayInfo *m_lazy_display; // the display that m_lazy_filters are from, see build_lazy_filters()
 	std::vector<FeEmulatorInfo> m_emulators; // we keep the emulator info here because we need it for checking file availability
 
 	std::map<std::string, bool> m_tags; // bool is flag of whether the tag has been changed
 	std::set<std::string> m_extra_favs; // store for favourites that are filtered out by global filter
 	std::multimap< std::string, const char * > m_extra_tags; // store for tags that are filtered out by global filter
 	FeFilter *m_global_filter_ptr; // this will only get set if we are globally filtering out games during the initial load
+	FeRomListCache m_cache; // binary cache of the romlist file, only used during load
+	FeStatsStore m_stats; // play stats for this romlist, only open if stats are loaded or updated
+	FeRomNameIndex m_name_index; // romname lookup for m_list, built when first needed
+	FeSortRankCache m_sort_ranks; // sorted orders used to sort filters
+	FeSearchIndex m_search_index; // text search index, built when first searched
+	std::vector< FeNavIndex > m_filter_nav; // jump tables for each filter in m_filtered_list
+	sf::Uint32 m_fav_serial; // changed whenever favourites might have been changed
 
 	std::string m_user_path;
 	std::string m_romlist_name;
@@ -90,6 +219,25 @@ private:
 	//
 	void build_single_filter_list( FeFilter *f, std::vector< FeRomInfo *> &result );
 
+	// get the sorted order to use for filter "f" (NULL if it isn't sorted)
+	//
+	const std::vector< sf::Uint32 > *get_sort_ranks( FeFilter *f );
+
+	// prepare "result" and "f" before filtering
+	//
+	void begin_filter_list( FeFilter *f, std::vector< FeRomInfo *> &result );
+
+	// (re)build m_filtered_list for the specified filter indices of "display", using worker threads
+	//
+	void build_filters( FeDisplayInfo &display, const std::vector< int > &indices );
+
+	// build the specified filter now if it hasn't been built yet.  This is called from
+	// the const accessors, building on demand doesn't change what they return.
+	//
+	void check_filter( int filter_idx ) const
+		{ if ( !m_lazy_filters.empty() ) const_cast< FeRomList * >( this )->build_lazy_filter( filter_idx ); };
+	void build_lazy_filter( int filter_idx );
+
 	// Fixes m_filtered_list as needed using the filters in the given "display", with the
 	// assumption that the specified "target" attribute for all games might have been changed
 	//
@@ -97,15 +245,22 @@ private:
 	//
 	bool fix_filters( FeDisplayInfo &display, FeRomInfo::Index target );
 
+	void check_name_index() { if ( !m_name_index.is_built() ) m_name_index.build( m_list ); };
+
 	void save_favs();
 	void save_tags();
 
+	// add a rom loaded from the romlist file or cache, applying the global filter if
+	// m_global_filter_ptr is set
+	void add_loaded_rom( const FeRomInfo &rom );
+
 public:
 	FeRomList( const std::string &config_path );
 	~FeRomList();
 
 	void init_as_empty_list();
 
+	// "stat_path" is the stats directory, or empty if stats aren't being loaded
 	bool load_romlist( const std::string &romlist_path,
 		const std::string &romlist_name,
 		const std::string &user_path,
@@ -114,6 +269,12 @@ public:
 
 	void create_filters( FeDisplayInfo &display ); // called by load_romlist()
 
+	// Build the filters that haven't been built yet, or drop them (leaving them
+	// empty) if "discard" is true.  This has to be done before the display passed
+	// to create_filters() is moved or deleted, or before its filters are changed.
+	//
+	void build_lazy_filters( bool discard=false );
+
 	int process_setting( const std::string &setting,
 		const std::string &value,
 		const std::string &fn );
@@ -126,13 +287,32 @@ public:
 		std::vector< std::pair<std::string, bool> > &tags_list ) const;
 	bool set_tag( FeRomInfo &rom, FeDisplayInfo &display, const std::string &tag, bool flag );
 
-	bool is_filter_empty( int filter_idx ) const { return m_filtered_list[filter_idx].empty(); };
-	int filter_size( int filter_idx ) const { return (int)m_filtered_list[filter_idx].size(); };
-	const FeRomInfo &lookup( int filter_idx, int idx) const { return *(m_filtered_list[filter_idx][idx]); };
-	FeRomInfo &lookup( int filter_idx, int idx) { return *(m_filtered_list[filter_idx][idx]); };
+	bool is_filter_empty( int filter_idx ) const { check_filter( filter_idx ); return m_filtered_list[filter_idx].empty(); };
+	int filter_size( int filter_idx ) const { check_filter( filter_idx ); return (int)m_filtered_list[filter_idx].size(); };
+	const FeRomInfo &lookup( int filter_idx, int idx) const { check_filter( filter_idx ); return *(m_filtered_list[filter_idx][idx]); };
+	FeRomInfo &lookup( int filter_idx, int idx) { check_filter( filter_idx ); return *(m_filtered_list[filter_idx][idx]); };
+
+	// offsets from "idx" in the filter to the next/previous letter or favourite,
+	// see FeNavIndex
+	int get_letter_offset( int filter_idx, int idx, int step );
+	int get_fav_offset( int filter_idx, int idx, int step );
+	sf::Uint32 get_fav_serial() const { return m_fav_serial; };
 
 	FeRomInfoListType &get_list() { return m_list; };
 
+	// Find the entry in the list that matches "rom" (using FeRomInfo::full_comparison()).
+	// Returns get_list().end() if there is none
+	//
+	FeRomInfoListType::iterator find_entry( const FeRomInfo &rom );
+
+	// Change the list while keeping the romname lookup up to date
+	//
+	FeRomInfoListType::iterator erase_entry( FeRomInfoListType::iterator pos );
+	FeRomInfoListType::iterator insert_entry( FeRomInfoListType::iterator pos, const FeRomInfo &rom );
+	void replace_entry( FeRomInfoListType::iterator pos, const FeRomInfo &rom );
+	FeStatsStore &get_stats() { return m_stats; };
+	FeSearchIndex &get_search_index() { return m_search_index; };
+
 	void get_file_availability();
 
 	FeEmulatorInfo *get_emulator( const std::string & );
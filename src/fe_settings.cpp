@@ -24,6 +24,8 @@
 #include "fe_settings.hpp"
 #include "fe_present.hpp"
 #include "zip.hpp"
+#include "image_loader.hpp"
+#include "script_cache.hpp"
 #include <iostream>
 #include <sstream>
 #include "nowide/fstream.hpp"
@@ -114,6 +116,7 @@ const char *FE_DATA_PATH = NULL;
 
 const char *FE_CFG_FILE					= "attract.cfg";
 const char *FE_STATE_FILE				= "attract.am";
+const char *FE_PATH_CACHE_FILE			= "path-cache.dat";
 const char *FE_SCREENSAVER_FILE		= "screensaver.nut";
 const char *FE_PLUGIN_FILE				= "plugin.nut";
 const char *FE_LOADER_FILE				= "loader.nut";
@@ -137,6 +140,8 @@ const char *FE_STATS_SUBDIR			= "stats/";
 const char *FE_LOADER_SUBDIR			= "loader/";
 const char *FE_INTRO_SUBDIR			= "intro/";
 const char *FE_SCRAPER_SUBDIR			= "scraper/";
+const char *FE_POSTER_SUBDIR			= "poster/";
+const char *FE_SCRIPT_CACHE_SUBDIR	= "script_cache/";
 const char *FE_MENU_ART_SUBDIR		= "menu-art/";
 const char *FE_OVERVIEW_SUBDIR		= "overview/";
 const char *FE_EMULATOR_SCRIPT_SUBDIR		= "emulators/script/";
@@ -323,6 +328,7 @@ void FeSettings::clear()
 	m_current_config_object=NULL;
 	m_current_display = -1;
 
+	m_rl.build_lazy_filters( true );
 	m_displays.clear();
 	m_rl.clear_emulators();
 	m_plugins.clear();
@@ -374,6 +380,15 @@ void FeSettings::load()
 	FeRomListSorter::init_title_rex( rex_str );
 
 	load_state();
+	m_path_cache.load( m_config_path + FE_PATH_CACHE_FILE );
+
+	confirm_directory( m_config_path, FE_SCRIPT_CACHE_SUBDIR );
+	FeScriptCache::get_ref().set_path( m_config_path + FE_SCRIPT_CACHE_SUBDIR );
+
+#ifndef NO_MOVIE
+	confirm_directory( m_config_path, FE_POSTER_SUBDIR );
+	FePosterCache::get_ref().set_path( m_config_path + FE_POSTER_SUBDIR );
+#endif
 	init_display();
 
 	// Make sure we have some keyboard mappings
@@ -427,6 +442,8 @@ const char *FeSettings::configSettingStrings[] =
 	"hide_console",
 #endif
 	"video_decoder",
+	"video_decode_threads",
+	"image_cache_mbytes",
 	"menu_prompt",
 	"menu_layout",
 	NULL
@@ -638,7 +655,10 @@ void FeSettings::init_display()
 
 	std::string stat_path;
 	if ( m_track_usage )
-		stat_path = m_config_path + FE_STATS_SUBDIR + romlist_name + "/";
+	{
+		confirm_directory( m_config_path, FE_STATS_SUBDIR );
+		stat_path = m_config_path + FE_STATS_SUBDIR;
+	}
 
 	std::string list_path( m_config_path );
 	list_path += FE_ROMLIST_SUBDIR;
@@ -681,7 +701,7 @@ void FeSettings::init_display()
 	//
 	construct_display_maps();
 
-	m_path_cache.clear();
+	m_path_cache.revalidate();
 }
 
 void FeSettings::construct_display_maps()
@@ -733,6 +753,8 @@ void FeSettings::save_state()
 
 		outfile.close();
 	}
+
+	m_path_cache.save( m_config_path + FE_PATH_CACHE_FILE );
 }
 
 void FeSettings::load_state()
@@ -982,6 +1004,7 @@ int FeSettings::get_rom_index( int filter_index, int offset ) const
 void FeSettings::set_search_rule( const std::string &rule_str )
 {
 	m_current_search.clear();
+	m_search_nav.clear();
 	m_current_search_index=0;
 	m_current_search_str.clear();
 
@@ -995,17 +1018,72 @@ void FeSettings::set_search_rule( const std::string &rule_str )
 	rule.init();
 
 	int filter_index = get_current_filter_index();
-	for ( int i=0; i<m_rl.filter_size( filter_index ); i++ )
+
+	//
+	// If the rule can be narrowed down with the search index then we only
+	// need to check the entries with one of the indexed matches
+	//
+	std::string text;
+	std::vector< sf::Uint32 > matches;
+	if ( FeSearchIndex::get_search_text( rule, text )
+			&& m_rl.get_search_index().find( rule.get_target(), text, matches ) )
 	{
-		FeRomInfo &r = m_rl.lookup( filter_index, i );
-		if ( rule.apply_rule( r ) )
-			m_current_search.push_back( &r );
+		FeRomInfo::Index target = rule.get_target();
+		std::vector< bool > is_match( FeRomInfo::get_column_size( target ), false );
+
+		for ( std::vector< sf::Uint32 >::iterator itr=matches.begin(); itr!=matches.end(); ++itr )
+			is_match[ *itr ] = true;
+
+		for ( int i=0; i<m_rl.filter_size( filter_index ); i++ )
+		{
+			FeRomInfo &r = m_rl.lookup( filter_index, i );
+			if ( is_match[ r.get_info_id( target ) ] && rule.apply_rule( r ) )
+				m_current_search.push_back( &r );
+		}
+	}
+	else
+	{
+		for ( int i=0; i<m_rl.filter_size( filter_index ); i++ )
+		{
+			FeRomInfo &r = m_rl.lookup( filter_index, i );
+			if ( rule.apply_rule( r ) )
+				m_current_search.push_back( &r );
+		}
 	}
 
 	if ( !m_current_search.empty() )
 		m_current_search_str = rule_str;
 }
 
+int FeSettings::type_ahead( const std::string &text )
+{
+	std::string folded;
+	FeSearchIndex::fold_case( text, folded );
+
+	std::vector< sf::Uint32 > matches;
+	if (( folded.empty() )
+			|| ( !m_rl.get_search_index().find( FeRomInfo::Title, folded, matches ) )
+			|| ( matches.empty() ))
+		return 0;
+
+	std::vector< bool > is_match( FeRomInfo::get_column_size( FeRomInfo::Title ), false );
+	for ( std::vector< sf::Uint32 >::iterator itr=matches.begin(); itr!=matches.end(); ++itr )
+		is_match[ *itr ] = true;
+
+	int filter_index = get_current_filter_index();
+	int size = get_filter_size( filter_index );
+	int idx = get_rom_index( filter_index, 0 );
+
+	for ( int i=1; i<size; i++ )
+	{
+		FeRomInfo *r = get_rom_absolute( filter_index, ( idx + i ) % size );
+		if ( r && is_match[ r->get_info_id( FeRomInfo::Title ) ] )
+			return i;
+	}
+
+	return 0;
+}
+
 const std::string &FeSettings::get_search_rule() const
 {
 	return m_current_search_str;
@@ -1869,18 +1947,10 @@ int FeSettings::get_prev_fav_offset()
 	int filter_index = get_current_filter_index();
 	int idx = get_rom_index( filter_index, 0 );
 
-	for ( int i=1; i < get_filter_size( filter_index ); i++ )
-	{
-		int t_idx = ( i <= idx ) ? ( idx - i )
-			: ( get_filter_size( filter_index ) - ( i - idx ) );
-
-		if ( get_rom_info_absolute( filter_index,
-				t_idx,
-				FeRomInfo::Favourite ).compare( "1" ) == 0 )
-			return ( t_idx - idx );
-	}
+	if ( !m_current_search.empty() )
+		return m_search_nav.get_fav_offset( m_current_search, idx, -1, m_rl.get_fav_serial() );
 
-	return 0;
+	return m_rl.get_fav_offset( filter_index, idx, -1 );
 }
 
 int FeSettings::get_next_fav_offset()
@@ -1888,16 +1958,10 @@ int FeSettings::get_next_fav_offset()
 	int filter_index = get_current_filter_index();
 	int idx = get_rom_index( filter_index, 0 );
 
-	for ( int i=1; i < get_filter_size( filter_index ); i++ )
-	{
-		int t_idx = ( idx + i ) % get_filter_size( filter_index );
-		if ( get_rom_info_absolute( filter_index,
-				t_idx,
-				FeRomInfo::Favourite ).compare( "1" ) == 0 )
-			return ( t_idx - idx );
-	}
+	if ( !m_current_search.empty() )
+		return m_search_nav.get_fav_offset( m_current_search, idx, 1, m_rl.get_fav_serial() );
 
-	return 0;
+	return m_rl.get_fav_offset( filter_index, idx, 1 );
 }
 
 int FeSettings::get_next_letter_offset( int step )
@@ -1905,30 +1969,10 @@ int FeSettings::get_next_letter_offset( int step )
 	int filter_index = get_current_filter_index();
 	int idx = get_rom_index( filter_index, 0 );
 
-	FeRomListSorter s;
-	const char curr_l = s.get_first_letter( get_rom_absolute( filter_index, idx ) );
-	bool is_alpha = std::isalpha( curr_l );
-	int retval = 0;
-
-	for ( int i=1; i < get_filter_size( filter_index ); i++ )
-	{
-		int t_idx;
-		if ( step > 0 )
-			t_idx = ( idx + i ) % get_filter_size( filter_index );
-		else
-			t_idx = ( i <= idx ) ? ( idx - i ) : ( get_filter_size( filter_index ) - ( i - idx ) );
-
-		const char test_l = s.get_first_letter( get_rom_absolute( filter_index, t_idx ) );
-
-		if ((( is_alpha ) && ( test_l != curr_l ))
-				|| ((!is_alpha) && ( std::isalpha( test_l ) )))
-		{
-			retval = t_idx - idx;
-			break;
-		}
-	}
+	if ( !m_current_search.empty() )
+		return m_search_nav.get_letter_offset( m_current_search, idx, step );
 
-	return retval;
+	return m_rl.get_letter_offset( filter_index, idx, step );
 }
 
 void FeSettings::get_current_tags_list(
@@ -2241,17 +2285,19 @@ void FeSettings::update_stats( int play_count, int play_time )
 	if ( !rom )
 		return;
 
-	const std::string rl_name = m_displays[m_current_display].get_info( FeDisplayInfo::Romlist );
-
-	std::string path = m_config_path + FE_STATS_SUBDIR;
-	confirm_directory( path, rl_name );
-
-	path += rl_name + "/";
+	FeStatsStore &stats = m_rl.get_stats();
+	if ( !stats.is_open() )
+	{
+		confirm_directory( m_config_path, FE_STATS_SUBDIR );
+		stats.open( m_config_path + FE_STATS_SUBDIR,
+			m_displays[m_current_display].get_info( FeDisplayInfo::Romlist ) );
+	}
 
 	FeDebug() << "Updating stats: increment play count by " << play_count
 		<< " and play time by " << play_time << " seconds." << std::endl;
 
-	rom->update_stats( path, play_count, play_time );
+	rom->update_stats( stats, play_count, play_time );
+	stats.flush();
 }
 
 int FeSettings::exit_command() const
@@ -2289,54 +2335,15 @@ void FeSettings::do_text_substitutions( std::string &str, int filter_offset, int
 				get_rom_index( filter_index, index_offset ) );
 }
 
-void FeSettings::do_text_substitutions_absolute( std::string &str, int filter_index, int rom_index )
+namespace
 {
 	//
-	// Perform substitutions of the [XXX] sequences occurring in str
+	// Special case attributes, evaluated by get_special_token_text().
+	// Template tokens below FeRomInfo::LAST_INDEX are rom info attributes,
+	// tokens from FeRomInfo::LAST_INDEX onward index into this list
 	//
-	size_t pos = str.find( "[" );
-	while ( pos != std::string::npos )
+	const char *get_special_token( int i )
 	{
-		size_t close = str.find_first_of( ']', pos+1 );
-
-		if ( close == std::string::npos )
-			break; // done, no more enclosed tokens
-
-		std::string token = str.substr( pos+1, close-pos-1 );
-		bool matched=false;
-
-		//
-		// First check for rom info attribute matches
-		//
-		for ( int i=0; i<FeRomInfo::LAST_INDEX; i++ )
-		{
-			// these are special cases dealt with elsewhere
-			if (( i == FeRomInfo::Title )
-					|| ( i == FeRomInfo::PlayedTime ))
-				continue;
-
-			if ( token.compare( FeRomInfo::indexStrings[i] ) == 0 )
-			{
-				const std::string &rep = get_rom_info_absolute(
-						filter_index,
-						rom_index,
-						(FeRomInfo::Index)i );
-
-				str.replace( pos, close-pos+1, rep );
-				pos += rep.size();
-				matched=true;
-			}
-		}
-
-		if ( matched )
-		{
-			pos = str.find( "[", pos );
-			continue;
-		}
-
-		//
-		// Next check for various special case attributes
-		//
 		const char *tokenStrings[] =
 		{
 			"DisplayName",
@@ -2357,135 +2364,282 @@ void FeSettings::do_text_substitutions_absolute( std::string &str, int filter_in
 			NULL
 		};
 
-		int i=0;
-		while ( tokenStrings[i] != NULL )
+		return tokenStrings[i];
+	}
+
+	int find_text_token( const char *token, size_t len )
+	{
+		//
+		// First check for rom info attribute matches
+		//
+		for ( int i=0; i<FeRomInfo::LAST_INDEX; i++ )
 		{
-			if ( token.compare( tokenStrings[i] ) == 0 )
-			{
-				matched = true;
-				break;
-			}
+			// these are special cases dealt with elsewhere
+			if (( i == FeRomInfo::Title )
+					|| ( i == FeRomInfo::PlayedTime ))
+				continue;
 
-			i++;
+			if (( strncmp( token, FeRomInfo::indexStrings[i], len ) == 0 )
+					&& ( FeRomInfo::indexStrings[i][len] == 0 ))
+				return i;
 		}
 
-		if ( !matched )
+		//
+		// Next check for various special case attributes
+		//
+		for ( int i=0; get_special_token( i ) != NULL; i++ )
+		{
+			const char *t = get_special_token( i );
+			if (( strncmp( token, t, len ) == 0 ) && ( t[len] == 0 ))
+				return FeRomInfo::LAST_INDEX + i;
+		}
+
+		return -1;
+	}
+};
+
+FeTextTemplate::FeTextTemplate()
+{
+}
+
+FeTextTemplate::FeTextTemplate( const std::string &format )
+{
+	compile( format );
+}
+
+void FeTextTemplate::compile( const std::string &format )
+{
+	m_format = format;
+	m_ops.clear();
+	m_magic.clear();
+
+	//
+	// Note every "[!" sequence that has a closing bracket after it.  These
+	// can overlap (i.e. "[!a[!b]"), the script skips over any that fall
+	// within a token it has already replaced
+	//
+	Magic m;
+	m.slot = -1;
+	m.serial = 0;
+
+	size_t pos = m_format.find( "[!" );
+	while ( pos != std::string::npos )
+	{
+		size_t close = m_format.find_first_of( ']', pos+2 );
+		if ( close == std::string::npos )
+			break;
+
+		m.name = m_format.substr( pos+2, close-pos-2 );
+		m.pos = pos;
+		m.len = close-pos+1;
+		m_magic.push_back( m );
+
+		pos = m_format.find( "[!", pos+2 );
+	}
+
+	//
+	// Split the [XXX] sequences occurring in the format string out from the
+	// literal text around them.  Unrecognized sequences are left as text
+	//
+	Op op;
+	size_t lit = 0;
+	pos = m_format.find( "[" );
+	while ( pos != std::string::npos )
+	{
+		size_t close = m_format.find_first_of( ']', pos+1 );
+
+		if ( close == std::string::npos )
+			break; // done, no more enclosed tokens
+
+		int token = find_text_token( m_format.c_str() + pos + 1, close-pos-1 );
+		if ( token < 0 )
 		{
-			pos = str.find( "[", pos+1 );
+			pos = m_format.find( "[", pos+1 );
 			continue;
 		}
 
-		std::string rep;
-		switch ( i )
+		if ( pos > lit )
 		{
-		case 0: // "DisplayName"
-		case 1: // "ListTitle" // deprecated as of 1.5
-			rep = get_current_display_title();
-			break;
+			op.token = -1;
+			op.pos = lit;
+			op.len = pos - lit;
+			m_ops.push_back( op );
+		}
 
-		case 2:	// "FilterName"
-		case 3: // "ListFilterName" // deprecated as of 1.5
-			rep = get_filter_name( filter_index );
-			break;
+		op.token = token;
+		op.pos = pos;
+		op.len = close-pos+1;
+		m_ops.push_back( op );
 
-		case 4: // "ListSize"
-			rep = as_str( get_filter_size( filter_index ) );
-			break;
+		lit = close+1;
+		pos = m_format.find( "[", lit );
+	}
 
-		case 5: // "ListEntry"
-			rep = as_str( rom_index + 1 );
-			break;
+	if ( lit < m_format.size() )
+	{
+		op.token = -1;
+		op.pos = lit;
+		op.len = m_format.size() - lit;
+		m_ops.push_back( op );
+	}
+}
 
-		case 6: // "Search"
-			rep = m_current_search_str;
-			break;
+void FeSettings::do_text_substitutions_absolute( std::string &str, int filter_index, int rom_index )
+{
+	if ( str.find( "[" ) == std::string::npos )
+		return;
 
-		case 7: // "Title"
-		case 8: // "TitleFull"
-			rep = get_rom_info_absolute( filter_index,
-				rom_index, FeRomInfo::Title );
-			if (( m_hide_brackets ) && ( i == 7 )) // 7 == Title
-				rep = name_with_brackets_stripped( rep );
-			break;
+	FeTextTemplate t( str );
+	std::string out;
 
-		case 9: // "PlayedTime"
-			rep = get_played_display_string( filter_index, rom_index );
-			break;
+	do_text_substitutions_absolute( t, out, filter_index, rom_index );
+	str.swap( out );
+}
 
-		case 10: // "SortName"
-		case 11: // "SortValue"
-			{
-				FeRomInfo::Index sort_by;
-				bool reverse_sort;
-				int list_limit;
-				std::string sort_name;
+void FeSettings::do_text_substitutions( const FeTextTemplate &t, std::string &out, int filter_offset, int index_offset )
+{
+	int filter_index = get_filter_index_from_offset( filter_offset );
+	do_text_substitutions_absolute(
+				t,
+				out,
+				filter_index,
+				get_rom_index( filter_index, index_offset ) );
+}
 
-				get_current_sort( sort_by, reverse_sort, list_limit );
+void FeSettings::do_text_substitutions_absolute( const FeTextTemplate &t, std::string &out, int filter_index, int rom_index )
+{
+	out.clear();
 
-				if ( sort_by == FeRomInfo::LAST_INDEX )
-				{
-					get_resource( "None", sort_name );
-					sort_by = FeRomInfo::Title;
-				}
-				else
-					get_resource( FeRomInfo::indexStrings[sort_by], sort_name );
+	std::string rep;
+	for ( std::vector<FeTextTemplate::Op>::const_iterator itr = t.m_ops.begin();
+			itr != t.m_ops.end(); ++itr )
+	{
+		if ( (*itr).token < 0 )
+			out.append( t.m_format, (*itr).pos, (*itr).len );
+		else if ( (*itr).token < FeRomInfo::LAST_INDEX )
+			out.append( get_rom_info_absolute(
+				filter_index,
+				rom_index,
+				(FeRomInfo::Index)(*itr).token ) );
+		else
+		{
+			rep.clear();
+			get_special_token_text( (*itr).token - FeRomInfo::LAST_INDEX,
+				rep, filter_index, rom_index );
+			out.append( rep );
+		}
+	}
+}
 
+void FeSettings::get_special_token_text( int token, std::string &rep, int filter_index, int rom_index )
+{
+	switch ( token )
+	{
+	case 0: // "DisplayName"
+	case 1: // "ListTitle" // deprecated as of 1.5
+		rep = get_current_display_title();
+		break;
 
-				if ( i == 10 ) // SortName
-				{
-					rep = sort_name;
-				}
-				else
-				{
-					if ( sort_by == FeRomInfo::PlayedTime )
-						rep = get_played_display_string(
-							filter_index,
-							rom_index );
-					else
-						rep = get_rom_info_absolute(
-							filter_index,
-							rom_index, sort_by );
-				}
+	case 2:	// "FilterName"
+	case 3: // "ListFilterName" // deprecated as of 1.5
+		rep = get_filter_name( filter_index );
+		break;
+
+	case 4: // "ListSize"
+		rep = as_str( get_filter_size( filter_index ) );
+		break;
+
+	case 5: // "ListEntry"
+		rep = as_str( rom_index + 1 );
+		break;
+
+	case 6: // "Search"
+		rep = m_current_search_str;
+		break;
+
+	case 7: // "Title"
+	case 8: // "TitleFull"
+		rep = get_rom_info_absolute( filter_index,
+			rom_index, FeRomInfo::Title );
+		if (( m_hide_brackets ) && ( token == 7 )) // 7 == Title
+			rep = name_with_brackets_stripped( rep );
+		break;
+
+	case 9: // "PlayedTime"
+		rep = get_played_display_string( filter_index, rom_index );
+		break;
+
+	case 10: // "SortName"
+	case 11: // "SortValue"
+		{
+			FeRomInfo::Index sort_by;
+			bool reverse_sort;
+			int list_limit;
+			std::string sort_name;
+
+			get_current_sort( sort_by, reverse_sort, list_limit );
+
+			if ( sort_by == FeRomInfo::LAST_INDEX )
+			{
+				get_resource( "None", sort_name );
+				sort_by = FeRomInfo::Title;
 			}
-			break;
+			else
+				get_resource( FeRomInfo::indexStrings[sort_by], sort_name );
 
-		case 12: // "System"
-		case 13: // "SystemN"
+
+			if ( token == 10 ) // SortName
+			{
+				rep = sort_name;
+			}
+			else
 			{
-				const std::string &en
-					= get_rom_info_absolute(
+				if ( sort_by == FeRomInfo::PlayedTime )
+					rep = get_played_display_string(
+						filter_index,
+						rom_index );
+				else
+					rep = get_rom_info_absolute(
 						filter_index,
-						rom_index,
-						FeRomInfo::Emulator );
+						rom_index, sort_by );
+			}
+		}
+		break;
 
-				const FeEmulatorInfo *emu = get_emulator( en );
-				if ( emu )
-				{
-					const std::vector< std::string > &ss =
-						emu->get_systems();
+	case 12: // "System"
+	case 13: // "SystemN"
+		{
+			const std::string &en
+				= get_rom_info_absolute(
+					filter_index,
+					rom_index,
+					FeRomInfo::Emulator );
+
+			const FeEmulatorInfo *emu = get_emulator( en );
+			if ( emu )
+			{
+				const std::vector< std::string > &ss =
+					emu->get_systems();
 
-					if ( !ss.empty() )
-					{
-						rep = ( i == 12 )
-							? ss.front()
-							: ss.back();
-					}
+				if ( !ss.empty() )
+				{
+					rep = ( token == 12 )
+						? ss.front()
+						: ss.back();
 				}
 			}
-			break;
-
-		case 14: // "Overview"
-			get_game_overview_absolute( filter_index, rom_index, rep );
-			break;
-
-		default:
-			ASSERT( 0 ); // unhandled token
-			break;
 		}
+		break;
+
+	case 14: // "Overview"
+		get_game_overview_absolute( filter_index, rom_index, rep );
+		break;
 
-		str.replace( pos, close-pos+1, rep );
-		pos = str.find( "[", pos+rep.size() );
+	default:
+		ASSERT( 0 ); // unhandled token
+		break;
 	}
+
 }
 
 std::string FeSettings::get_played_display_string( int filter_index, int rom_index )
@@ -2756,6 +2910,19 @@ const std::string FeSettings::get_info( int index ) const
 		return FeMedia::get_current_decoder();
 #endif
 
+	case VideoDecodeThreads:
+#ifdef NO_MOVIE
+		return "auto";
+#else
+		{
+			int t = FeMedia::get_decode_threads();
+			return ( t == 0 ) ? "auto" : as_str( t );
+		}
+#endif
+
+	case ImageCacheSize:
+		return as_str( (int)( FeImageLoader::get_ref().get_cache_size() / ( 1024 * 1024 ) ) );
+
 	case MenuPrompt:
 		return m_menu_prompt;
 
@@ -3012,6 +3179,23 @@ bool FeSettings::set_info( int index, const std::string &value )
 #endif
 		break;
 
+	case VideoDecodeThreads:
+#ifndef NO_MOVIE
+		// "auto" (or anything else that isn't a number) gives 0
+		FeMedia::set_decode_threads( as_int( value ) );
+#endif
+		break;
+
+	case ImageCacheSize:
+		{
+			int mbytes = as_int( value );
+			if ( mbytes < 0 )
+				mbytes = 0;
+
+			FeImageLoader::get_ref().set_cache_size( (size_t)mbytes * 1024 * 1024 );
+		}
+		break;
+
 	case MenuLayout:
 		if ( m_menu_layout.compare( value ) != 0 )
 		{
@@ -3041,8 +3225,10 @@ FeDisplayInfo *FeSettings::get_display( int index )
 	return &(*itr);
 }
 
-void FeSettings::create_filter( FeDisplayInfo &d, const std::string &name ) const
+void FeSettings::create_filter( FeDisplayInfo &d, const std::string &name )
 {
+	m_rl.build_lazy_filters();
+
 	FeFilter new_filter( name );
 
 	std::string defaults_file;
@@ -3052,8 +3238,17 @@ void FeSettings::create_filter( FeDisplayInfo &d, const std::string &name ) cons
 	d.append_filter( new_filter );
 }
 
+void FeSettings::delete_filter( FeDisplayInfo &d, int index )
+{
+	m_rl.build_lazy_filters();
+	d.delete_filter( index );
+}
+
 FeDisplayInfo *FeSettings::create_display( const std::string &n )
 {
+	// m_displays may get reallocated
+	m_rl.build_lazy_filters();
+
 	if ( m_current_display == -1 )
 		m_current_display=0;
 
@@ -3140,6 +3335,8 @@ void FeSettings::delete_display( int index )
 	if ( ( index < 0 ) || ( index >= (int)m_displays.size() ))
 		return;
 
+	m_rl.build_lazy_filters();
+
 	std::vector<FeDisplayInfo>::iterator itr=m_displays.begin() + index;
 	m_displays.erase( itr );
 
@@ -3622,12 +3819,17 @@ bool FeSettings::get_module_path(
 	return false;
 }
 
+//
+// "is_random" (if not NULL) gets set to true if the results were picked at
+// random from a subdirectory, in which case they shouldn't be memoized
+//
 bool gather_artwork_filenames(
 	const std::vector < std::string > &art_paths,
 	const std::string &target_name,
 	std::vector<std::string> &vids,
 	std::vector<std::string> &images,
-	FePathCache *path_cache )
+	FePathCache *path_cache,
+	bool *is_random=NULL )
 {
 	for ( std::vector< std::string >::const_iterator itr = art_paths.begin();
 			itr != art_paths.end(); ++itr )
@@ -3746,6 +3948,9 @@ bool gather_artwork_filenames(
 			std::random_shuffle( vid_contents.begin(), vid_contents.end() );
 			std::random_shuffle( img_contents.begin(), img_contents.end() );
 
+			if ( is_random )
+				*is_random = true;
+
 			images.insert( images.end(), img_contents.begin(), img_contents.end() );
 			vids.insert( vids.end(), vid_contents.begin(), vid_contents.end() );
 		}
@@ -3796,6 +4001,39 @@ bool FeSettings::internal_get_best_artwork_file(
 	std::vector<std::string> &image_list,
 	bool image_only,
 	bool ignore_emu )
+{
+	m_art_cache.validate( m_path_cache.get_generation(),
+		m_current_display, m_present_state );
+
+	int flags = ( image_only ? 1 : 0 ) | ( ignore_emu ? 2 : 0 );
+
+	bool retval;
+	if ( m_art_cache.find( rom, art_name, flags, vid_list, image_list, retval ) )
+		return retval;
+
+	std::vector<std::string> vids;
+	std::vector<std::string> images;
+	bool is_random=false;
+
+	retval = resolve_best_artwork_file( rom, art_name, vids, images,
+		image_only, ignore_emu, is_random );
+
+	if ( !is_random )
+		m_art_cache.insert( rom, art_name, flags, vids, images, retval );
+
+	vid_list.insert( vid_list.end(), vids.begin(), vids.end() );
+	image_list.insert( image_list.end(), images.begin(), images.end() );
+	return retval;
+}
+
+bool FeSettings::resolve_best_artwork_file(
+	const FeRomInfo &rom,
+	const std::string &art_name,
+	std::vector<std::string> &vid_list,
+	std::vector<std::string> &image_list,
+	bool image_only,
+	bool ignore_emu,
+	bool &is_random )
 {
 	std::vector < std::string > art_paths;
 
@@ -3871,7 +4109,7 @@ bool FeSettings::internal_get_best_artwork_file(
 		const std::string &cloneof = rom.get_info( FeRomInfo::Cloneof );
 
 		std::vector<std::string> romname_image_list;
-		if ( gather_artwork_filenames( art_paths, romname, vid_list, romname_image_list, &m_path_cache ) )
+		if ( gather_artwork_filenames( art_paths, romname, vid_list, romname_image_list, &m_path_cache, &is_random ) )
 		{
 			// test for "romname" specific videos first
 			if ( !image_only && !vid_list.empty() )
@@ -3881,7 +4119,7 @@ bool FeSettings::internal_get_best_artwork_file(
 		bool check_altname = ( !altname.empty() && ( romname.compare( altname ) != 0 ));
 
 		std::vector<std::string> altname_image_list;
-		if ( check_altname && gather_artwork_filenames( art_paths, altname, vid_list, altname_image_list, &m_path_cache ) )
+		if ( check_altname && gather_artwork_filenames( art_paths, altname, vid_list, altname_image_list, &m_path_cache, &is_random ) )
 		{
 			// test for "altname" specific videos second
 			if ( !image_only && !vid_list.empty() )
@@ -3891,7 +4129,7 @@ bool FeSettings::internal_get_best_artwork_file(
 		bool check_cloneof = ( !cloneof.empty() && (altname.compare( cloneof ) != 0 ));
 
 		std::vector<std::string> cloneof_image_list;
-		if ( check_cloneof && gather_artwork_filenames( art_paths, cloneof, vid_list, cloneof_image_list, &m_path_cache ) )
+		if ( check_cloneof && gather_artwork_filenames( art_paths, cloneof, vid_list, cloneof_image_list, &m_path_cache, &is_random ) )
 		{
 			// then "cloneof" specific videos
 			if ( !image_only && !vid_list.empty() )
@@ -3922,7 +4160,7 @@ bool FeSettings::internal_get_best_artwork_file(
 		// then "emulator"
 		if ( !ignore_emu && !emu_name.empty()
 			&& gather_artwork_filenames( art_paths,
-				emu_name, vid_list, image_list, &m_path_cache ) )
+				emu_name, vid_list, image_list, &m_path_cache, &is_random ) )
 			return true;
 	}
 
@@ -4055,26 +4293,16 @@ void FeSettings::update_romlist_after_edit(
 	//
 	// Update the in-memory romlist now
 	//
-	FeRomInfoListType &rl = m_rl.get_list();
+	FeRomInfoListType::iterator it = m_rl.find_entry( original );
 
-	for ( FeRomInfoListType::iterator it = rl.begin(); it != rl.end(); )
+	if ( it != m_rl.get_list().end() )
 	{
-		if ( (*it).full_comparison( original ) )
-		{
-			if ( u_type == EraseEntry )
-				it = rl.erase( it );
-			else if ( u_type == InsertEntry )
-				it = rl.insert( it, replacement );
-			else // UpdateEntry
-			{
-				(*it) = replacement;
-				++it;
-			}
-
-			break;
-		}
-		else
-			++it;
+		if ( u_type == EraseEntry )
+			m_rl.erase_entry( it );
+		else if ( u_type == InsertEntry )
+			m_rl.insert_entry( it, replacement );
+		else // UpdateEntry
+			m_rl.replace_entry( it, replacement );
 	}
 
 	// RomInfo operator== compares romname and emulator
@@ -4186,6 +4414,10 @@ void FeSettings::update_romlist_after_edit(
                         outfile << (*itl).as_output() << std::endl;
 
                 outfile.close();
+
+		// The romlist cache gets rebuilt on next load
+		delete_file( m_config_path + FE_ROMLIST_SUBDIR
+			+ romlist_name + FE_ROMLIST_CACHE_EXTENSION );
 	}
 
 	// Clean up stats if the last entry for a game is deleted
@@ -4193,14 +4425,15 @@ void FeSettings::update_romlist_after_edit(
 	if (( u_type == EraseEntry ) && !found_similar )
 	{
 		// stats
-		std::string path = m_config_path + FE_STATS_SUBDIR;
-		confirm_directory( path, romlist_name );
-
-		path += romlist_name + "/";
-		path += original.get_info( FeRomInfo::Romname );
-		path += FE_STAT_FILE_EXTENSION;
+		FeStatsStore &stats = m_rl.get_stats();
+		if ( !stats.is_open() )
+		{
+			confirm_directory( m_config_path, FE_STATS_SUBDIR );
+			stats.open( m_config_path + FE_STATS_SUBDIR, romlist_name );
+		}
 
-		delete_file( path );
+		stats.erase( original.get_info( FeRomInfo::Romname ) );
+		stats.flush();
 	}
 }
 
@@ -30,6 +30,7 @@
 #include "fe_util.hpp"
 #include "scraper_base.hpp"
 #include "path_cache.hpp"
+#include "text_template.hpp"
 #include <deque>
 
 extern const char *FE_ART_EXTENSIONS[];
@@ -135,6 +136,8 @@ public:
 		HideConsole,
 #endif
 		VideoDecoder,
+		VideoDecodeThreads,
+		ImageCacheSize,
 		MenuPrompt, // 'Displays Menu' prompt
 		MenuLayout, // 'Displays Menu' layout
 		LAST_INDEX
@@ -173,6 +176,7 @@ private:
 	std::vector<FePlugInfo> m_plugins;
 	std::vector<FeLayoutInfo> m_layout_params;
 	std::vector<FeRomInfo *> m_current_search;
+	FeNavIndex m_search_nav; // jump tables for m_current_search
 	std::vector<int> m_display_cycle; // display indices to show in cycle
 	std::vector<int> m_display_menu; // display indices to show in menu
 	std::map<GameExtra,std::string> m_game_extras; // "extra" rom settings for the current rom
@@ -180,6 +184,7 @@ private:
 					// display shortcuts are used)
 	FeRomList m_rl;
 	FePathCache m_path_cache;
+	FeArtworkCache m_art_cache; // memoized artwork lookups
 
 	FeInputMap m_inputmap;
 	FeSoundInfo m_sounds;
@@ -246,7 +251,9 @@ private:
 	void internal_load_language( const std::string &lang );
 
 	std::string get_played_display_string( int filter_index, int rom_index );
+	void get_special_token_text( int token, std::string &rep, int filter_index, int rom_index );
 
+	// memoized in m_art_cache, see resolve_best_artwork_file() for the lookup
 	bool internal_get_best_artwork_file(
 		const FeRomInfo &rom,
 		const std::string &art_name,
@@ -255,6 +262,15 @@ private:
 		bool image_only,
 		bool ignore_emu );
 
+	bool resolve_best_artwork_file(
+		const FeRomInfo &rom,
+		const std::string &art_name,
+		std::vector<std::string> &vid_list,
+		std::vector<std::string> &image_list,
+		bool image_only,
+		bool ignore_emu,
+		bool &is_random );
+
 	bool simple_scraper( FeImporterContext &, const char *, const char *, const char *, const char *, bool = false );
 	bool general_mame_scraper( FeImporterContext & );
 	bool thegamesdb_scraper( FeImporterContext & );
@@ -352,6 +368,11 @@ public:
 	void set_search_rule( const std::string &rule );
 	const std::string &get_search_rule() const;
 
+	// Return the offset from the current selection to the next game in the
+	// current list with a title containing "text" (ignoring case), or 0 if
+	// there is none
+	int type_ahead( const std::string &text );
+
 	bool select_last_launch();
 	bool is_last_launch( int filter_offset, int index_offset );
 	int get_joy_thresh() const { return m_joy_thresh; }
@@ -378,6 +399,10 @@ public:
 	void do_text_substitutions( std::string &str, int filter_offset, int index_offset );
 	void do_text_substitutions_absolute( std::string &str, int filter_index, int rom_index );
 
+	// Evaluate a precompiled template into "out", which is cleared first
+	void do_text_substitutions( const FeTextTemplate &t, std::string &out, int filter_offset, int index_offset );
+	void do_text_substitutions_absolute( const FeTextTemplate &t, std::string &out, int filter_index, int rom_index );
+
 	void get_current_sort( FeRomInfo::Index &idx, bool &rev, int &limit );
 
 	const std::string &get_current_display_title() const;
@@ -556,7 +581,8 @@ public:
 	FeDisplayInfo *create_display( const std::string &n );
 	void delete_display( int index );
 
-	void create_filter( FeDisplayInfo &l, const std::string &name ) const;
+	void create_filter( FeDisplayInfo &l, const std::string &name );
+	void delete_filter( FeDisplayInfo &l, int index );
 
 	// return true if specified romlist name is configured for use as a display
 	// list
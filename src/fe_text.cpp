@@ -31,6 +31,7 @@ FeText::FeText( FePresentableParent &p, const std::string &str,
 	int x, int y, int w, int h )
 	: FeBasePresentable( p ),
 	m_string( str ),
+	m_template( str ),
 	m_index_offset( 0 ),
 	m_filter_offset( 0 ),
 	m_user_charsize( -1 ),
@@ -142,15 +143,22 @@ void FeText::on_new_list( FeSettings *s )
 
 void FeText::on_new_selection( FeSettings *feSettings )
 {
-	std::string str = m_string;
-
-	FePresent::script_process_magic_strings( str,
-			m_filter_offset,
-			m_index_offset );
-
-	feSettings->do_text_substitutions( str, m_filter_offset, m_index_offset );
+	if ( m_template.has_magic() )
+	{
+		// The magic string results can contain further substitutions,
+		// so those are made on the resulting string
+		FePresent::script_process_magic_strings( m_template,
+				m_buffer,
+				m_filter_offset,
+				m_index_offset );
+
+		feSettings->do_text_substitutions( m_buffer, m_filter_offset, m_index_offset );
+	}
+	else
+		feSettings->do_text_substitutions( m_template, m_buffer,
+				m_filter_offset, m_index_offset );
 
-	m_draw_text.setString( str );
+	m_draw_text.setString( m_buffer );
 }
 
 void FeText::set_scale_factor( float scale_x, float scale_y )
@@ -235,6 +243,7 @@ const char *FeText::get_string_wrapped()
 void FeText::set_string(const char *s)
 {
 	m_string=s;
+	m_template.compile( m_string );
 	FePresent::script_do_update( this );
 }
 
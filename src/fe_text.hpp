@@ -26,6 +26,7 @@
 #include <SFML/Graphics.hpp>
 #include "fe_presentable.hpp"
 #include "tp.hpp"
+#include "text_template.hpp"
 
 class FeSettings;
 
@@ -112,6 +113,8 @@ private:
 
 	FeTextPrimative m_draw_text;
 	std::string m_string;
+	FeTextTemplate m_template;	// m_string, parsed for substitutions
+	std::string m_buffer;		// reused for substitution results
 	std::string m_font_name;
 	int m_index_offset;
 	int m_filter_offset;
@@ -57,6 +57,10 @@
 #else
 #include <sys/wait.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+#include <pthread.h>
+#include <fcntl.h>
 #include <pwd.h>
 #include <signal.h>
 #include <errno.h>
@@ -534,6 +538,103 @@ bool get_basename_from_extension(
 	return !(list.empty());
 }
 
+bool get_basenames_from_extensions(
+			std::vector< std::vector<std::string> > &lists,
+			const std::string &path,
+			const std::vector<std::string> &extensions )
+{
+	lists.clear();
+	lists.resize( extensions.size() );
+
+	if ( extensions.empty() )
+		return false;
+
+	//
+	// Precompute the set of (lowercase) final characters that any of the
+	// extensions can end with, so most non-matching entries get rejected
+	// without comparing against each extension in turn
+	//
+	bool last_char[256];
+	for ( int i=0; i<256; i++ )
+		last_char[i] = false;
+
+	bool match_all=false;
+	for ( std::vector<std::string>::const_iterator itr=extensions.begin();
+			itr!=extensions.end(); ++itr )
+	{
+		if ( (*itr).empty() )
+			match_all = true;
+		else
+			last_char[ (unsigned char)std::tolower( (*itr)[ (*itr).size()-1 ] ) ] = true;
+	}
+
+#ifdef SFML_SYSTEM_WINDOWS
+	std::string temp = path;
+	if ( !path.empty()
+			&& ( path[path.size()-1] != '/' )
+			&& ( path[path.size()-1] != '\\' ))
+		temp += "/";
+
+	temp += "*";
+
+	struct _wfinddata_t t;
+	intptr_t srch = _wfindfirst( widen( temp ).c_str(), &t );
+
+	if  ( srch < 0 )
+		return false;
+
+	do
+	{
+		std::string what = narrow( t.name );
+#else
+	DIR *dir;
+	struct dirent *ent;
+
+	if ( (dir = opendir( path.c_str() )) == NULL )
+		return false;
+
+	while ((ent = readdir( dir )) != NULL )
+	{
+		std::string what;
+		str_from_c( what, ent->d_name );
+#endif
+
+		if ( what.empty() || ( what.compare( "." ) == 0 ) || ( what.compare( ".." ) == 0 ) )
+			continue;
+
+		if ( !match_all
+				&& !last_char[ (unsigned char)std::tolower( what[ what.size()-1 ] ) ] )
+			continue;
+
+		for ( unsigned int i=0; i<extensions.size(); i++ )
+		{
+			const std::string &ext = extensions[i];
+			if ( !c_tail_compare( what.c_str(), what.size(), ext.c_str(), ext.size() ) )
+				continue;
+
+			std::vector<std::string> &list = lists[i];
+			if ( what.size() > ext.size() )
+			{
+				std::string bname = what.substr( 0, what.size() - ext.size() );
+
+				// same duplicate handling as get_basename_from_extension()
+				if ( list.empty() || ( bname.compare( list.back() ) != 0 ))
+					list.push_back( bname );
+			}
+			else
+				list.push_back( what );
+		}
+#ifdef SFML_SYSTEM_WINDOWS
+	} while ( _wfindnext( srch, &t ) == 0 );
+	_findclose( srch );
+#else
+	}
+	closedir( dir );
+#endif
+
+	return true;
+}
+
 bool get_filename_from_base(
 	std::vector<std::string> &in_list,
 	std::vector<std::string> &out_list,
@@ -743,6 +844,221 @@ void delete_file( const std::string &file )
 	nowide::remove( file.c_str() );
 }
 
+bool get_file_info( const std::string &file,
+	sf::Int64 &size,
+	sf::Int64 &mtime )
+{
+#ifdef SFML_SYSTEM_WINDOWS
+	struct __stat64 st;
+	if ( _wstat64( widen( file ).c_str(), &st ) != 0 )
+		return false;
+#else
+	struct stat st;
+	if ( stat( file.c_str(), &st ) != 0 )
+		return false;
+#endif
+
+	size = st.st_size;
+	mtime = st.st_mtime;
+	return true;
+}
+
+FeFileMapping::FeFileMapping()
+	: m_data( NULL ),
+	m_size( 0 )
+#ifdef SFML_SYSTEM_WINDOWS
+	, m_file( INVALID_HANDLE_VALUE ),
+	m_map( NULL )
+#endif
+{
+}
+
+FeFileMapping::~FeFileMapping()
+{
+	close();
+}
+
+bool FeFileMapping::open( const std::string &filename )
+{
+	close();
+
+#ifdef SFML_SYSTEM_WINDOWS
+	m_file = CreateFileW( widen( filename ).c_str(), GENERIC_READ,
+		FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+
+	if ( m_file == INVALID_HANDLE_VALUE )
+		return false;
+
+	LARGE_INTEGER fsize;
+	if (( !GetFileSizeEx( m_file, &fsize ) ) || ( fsize.QuadPart <= 0 ))
+	{
+		close();
+		return false;
+	}
+
+	m_map = CreateFileMappingW( m_file, NULL, PAGE_READONLY, 0, 0, NULL );
+	if ( m_map == NULL )
+	{
+		close();
+		return false;
+	}
+
+	m_data = (const char *)MapViewOfFile( m_map, FILE_MAP_READ, 0, 0, 0 );
+	if ( m_data == NULL )
+	{
+		close();
+		return false;
+	}
+
+	m_size = (size_t)fsize.QuadPart;
+#else
+	int fd = ::open( filename.c_str(), O_RDONLY );
+	if ( fd < 0 )
+		return false;
+
+	struct stat st;
+	if (( fstat( fd, &st ) != 0 ) || ( st.st_size <= 0 ))
+	{
+		::close( fd );
+		return false;
+	}
+
+	void *d = mmap( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+	::close( fd ); // the mapping stays valid after the descriptor is closed
+
+	if ( d == MAP_FAILED )
+		return false;
+
+	m_data = (const char *)d;
+	m_size = st.st_size;
+#endif
+
+	return true;
+}
+
+void FeFileMapping::close()
+{
+#ifdef SFML_SYSTEM_WINDOWS
+	if ( m_data )
+		UnmapViewOfFile( m_data );
+
+	if ( m_map )
+		CloseHandle( m_map );
+
+	if ( m_file != INVALID_HANDLE_VALUE )
+		CloseHandle( m_file );
+
+	m_map = NULL;
+	m_file = INVALID_HANDLE_VALUE;
+#else
+	if ( m_data )
+		munmap( (void *)m_data, m_size );
+#endif
+
+	m_data = NULL;
+	m_size = 0;
+}
+
+struct FeSemaphore::FeSemaphoreImp
+{
+#ifdef SFML_SYSTEM_WINDOWS
+	HANDLE sem;
+#else
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	unsigned int count;
+#endif
+};
+
+FeSemaphore::FeSemaphore()
+	: m_imp( new FeSemaphoreImp )
+{
+#ifdef SFML_SYSTEM_WINDOWS
+	m_imp->sem = CreateSemaphore( NULL, 0, 0x7fffffff, NULL );
+#else
+	pthread_mutex_init( &m_imp->mutex, NULL );
+	pthread_cond_init( &m_imp->cond, NULL );
+	m_imp->count = 0;
+#endif
+}
+
+FeSemaphore::~FeSemaphore()
+{
+#ifdef SFML_SYSTEM_WINDOWS
+	CloseHandle( m_imp->sem );
+#else
+	pthread_cond_destroy( &m_imp->cond );
+	pthread_mutex_destroy( &m_imp->mutex );
+#endif
+	delete m_imp;
+}
+
+void FeSemaphore::post()
+{
+#ifdef SFML_SYSTEM_WINDOWS
+	ReleaseSemaphore( m_imp->sem, 1, NULL );
+#else
+	pthread_mutex_lock( &m_imp->mutex );
+	m_imp->count++;
+	pthread_cond_signal( &m_imp->cond );
+	pthread_mutex_unlock( &m_imp->mutex );
+#endif
+}
+
+void FeSemaphore::wait()
+{
+#ifdef SFML_SYSTEM_WINDOWS
+	WaitForSingleObject( m_imp->sem, INFINITE );
+#else
+	pthread_mutex_lock( &m_imp->mutex );
+	while ( m_imp->count == 0 )
+		pthread_cond_wait( &m_imp->cond, &m_imp->mutex );
+
+	m_imp->count--;
+	pthread_mutex_unlock( &m_imp->mutex );
+#endif
+}
+
+bool FeSemaphore::wait( sf::Time timeout )
+{
+	if ( timeout < sf::Time::Zero )
+		timeout = sf::Time::Zero;
+
+#ifdef SFML_SYSTEM_WINDOWS
+	return ( WaitForSingleObject( m_imp->sem,
+		(DWORD)timeout.asMilliseconds() ) == WAIT_OBJECT_0 );
+#else
+	// pthread_cond_timedwait() takes an absolute (wall clock) time
+	struct timeval now;
+	gettimeofday( &now, NULL );
+
+	sf::Int64 usec = now.tv_usec + timeout.asMicroseconds();
+
+	struct timespec until;
+	until.tv_sec = now.tv_sec + usec / 1000000;
+	until.tv_nsec = ( usec % 1000000 ) * 1000;
+
+	bool retval = true;
+
+	pthread_mutex_lock( &m_imp->mutex );
+	while ( m_imp->count == 0 )
+	{
+		if ( pthread_cond_timedwait( &m_imp->cond,
+				&m_imp->mutex, &until ) == ETIMEDOUT )
+		{
+			retval = ( m_imp->count > 0 );
+			break;
+		}
+	}
+
+	if ( retval )
+		m_imp->count--;
+
+	pthread_mutex_unlock( &m_imp->mutex );
+	return retval;
+#endif
+}
+
 bool confirm_directory( const std::string &base, const std::string &sub )
 {
 	bool retval=false;
@@ -815,6 +1131,19 @@ const char *get_OS_string()
 #endif
 }
 
+int get_processor_count()
+{
+#if defined(SFML_SYSTEM_WINDOWS)
+	SYSTEM_INFO info;
+	GetSystemInfo( &info );
+	int count = info.dwNumberOfProcessors;
+#else
+	int count = sysconf( _SC_NPROCESSORS_ONLN );
+#endif
+
+	return ( count > 0 ) ? count : 1;
+}
+
 namespace
 {
 	bool process_check_for_hotkey(
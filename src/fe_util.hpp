@@ -26,6 +26,7 @@
 #include <vector>
 #include <string>
 #include <SFML/Config.hpp>
+#include <SFML/System/Time.hpp>
 
 #ifdef FE_DEBUG
 #include <cassert>
@@ -207,6 +208,19 @@ bool get_basename_from_extension(
 	const std::string &extension,
 	bool strip_extension = true );
 
+//
+// Scan "path" once and sort the files found into "lists", which gets one
+// list per entry in "extensions" (in the same order).  Each list holds the
+// base filenames (extension stripped) of the files with that extension, as
+// get_basename_from_extension() would return them.
+//
+// returns false if "path" could not be read
+//
+bool get_basenames_from_extensions(
+	std::vector< std::vector<std::string> > &lists,
+	const std::string &path,
+	const std::vector<std::string> &extensions );
+
 //
 // Return "in_list" of filenames in "path" where the base filename is "base_name"
 //
@@ -246,6 +260,72 @@ bool confirm_directory( const std::string &base, const std::string &sub );
 //
 void delete_file( const std::string &file );
 
+//
+// Get the size (in bytes) and last modification time of the named file
+//
+// returns false if the file could not be found
+//
+bool get_file_info( const std::string &file,
+	sf::Int64 &size,
+	sf::Int64 &mtime );
+
+//
+// Read-only memory mapping of a file's contents
+//
+class FeFileMapping
+{
+public:
+	FeFileMapping();
+	~FeFileMapping();
+
+	// returns false if the file could not be mapped
+	bool open( const std::string &filename );
+	void close();
+
+	bool is_open() const { return ( m_data != NULL ); };
+	const char *data() const { return m_data; };
+	size_t size() const { return m_size; };
+
+private:
+	FeFileMapping( const FeFileMapping & );
+	FeFileMapping &operator=( const FeFileMapping & );
+
+	const char *m_data;
+	size_t m_size;
+#ifdef SFML_SYSTEM_WINDOWS
+	void *m_file;
+	void *m_map;
+#endif
+};
+
+//
+// Counting semaphore, so that worker threads can sleep until there is
+// something for them to do instead of polling
+//
+class FeSemaphore
+{
+public:
+	FeSemaphore();
+	~FeSemaphore();
+
+	// increment the count, waking up a waiting thread if there is one
+	void post();
+
+	// wait until the count is non-zero and then decrement it
+	void wait();
+
+	// same as wait(), but give up after "timeout".  returns false if the
+	// wait timed out
+	bool wait( sf::Time timeout );
+
+private:
+	FeSemaphore( const FeSemaphore & );
+	FeSemaphore &operator=( const FeSemaphore & );
+
+	struct FeSemaphoreImp;
+	FeSemaphoreImp *m_imp;
+};
+
 //
 // Return integer as a string
 //
@@ -271,6 +351,11 @@ bool config_str_to_bool( const std::string &s );
 //
 const char *get_OS_string();
 
+//
+// Return the number of processors available (at least 1)
+//
+int get_processor_count();
+
 //
 // return the contents of the clipboard (if implemented for OS)
 //
@@ -35,6 +35,7 @@
 #include "fe_util.hpp"
 #include "fe_util_sq.hpp"
 #include "zip.hpp"
+#include "script_cache.hpp"
 
 #include <sqrat.h>
 
@@ -91,10 +92,15 @@ namespace
 		const std::string &filename,
 		bool silent=false )
 	{
+		HSQUIRRELVM vm = Sqrat::DefaultVM::Get();
+		SQInteger top = sq_gettop( vm );
+
 		std::string path_to_run=path;
 		try
 		{
-			Sqrat::Script sc;
+			std::string script_name = filename;
+			std::string source;
+
 			if ( is_supported_archive( path ) )
 			{
 				FeZipStream zip( path );
@@ -102,20 +108,21 @@ namespace
 				{
 					// Error opening specified filename.  Try to correct
 					// in case filename is in a subdir of the archive
-					std::string temp;
 					if ( get_archive_filename_with_base(
-							temp, path, filename ) )
-						zip.open( temp );
+							script_name, path, filename ) )
+						zip.open( script_name );
 					else
 						return false;
 				}
 
 				// in case error reporting is needed
 				path_to_run += " (";
-				path_to_run += filename;
+				path_to_run += script_name;
 				path_to_run += ")";
 
 				char *d = zip.getData();
+				if ( !d )
+					return false;
 
 				// CompileString chokes on whitespace at the start of a file,
 				// while CompileFile (below) doesn't seem to have the same
@@ -128,8 +135,7 @@ namespace
 				if ( i == zip.getSize() )
 					return false;
 
-				std::string str( &(d[i]), zip.getSize()-i );
-				sc.CompileString( str );
+				source.assign( &(d[i]), zip.getSize()-i );
 			}
 			else
 			{
@@ -137,16 +143,27 @@ namespace
 
 				if ( !file_exists( path_to_run ) )
 					return false;
-
-				sc.CompileFile( path_to_run );
 			}
 
+			// compile the script, or get it already compiled from the cache
+			if ( SQ_FAILED( FeScriptCache::get_ref().load( vm, path, script_name, source ) ) )
+				throw Sqrat::Exception( Sqrat::LastErrorString( vm ) );
+
 			FeDebug() << "Running script: " << path_to_run << std::endl;
-			sc.Run();
+
+			sq_pushroottable( vm );
+			SQRESULT res = sq_call( vm, 1, false, true );
+			sq_settop( vm, top );
+
+			if ( SQ_FAILED( res ) )
+				throw Sqrat::Exception( Sqrat::LastErrorString( vm ) );
+
 			FeDebug() << "Done script: " << path_to_run << std::endl;
 		}
 		catch(Sqrat:: Exception e )
 		{
+			sq_settop( vm, top );
+
 			if ( !silent )
 				FeLog() << "Script Error in " << path_to_run
 					<< " - " << e.Message() << std::endl;
@@ -320,7 +337,9 @@ FeVM::FeVM( FeSettings &fes, FeFontContainer &defaultfont, FeWindow &wnd, FeSoun
 	m_redraw_triggered( false ),
 	m_process_console_input( console_input ),
 	m_script_cfg( NULL ),
-	m_script_id( -1 )
+	m_script_id( -1 ),
+	m_magic_vm( NULL ),
+	m_magic_serial( 1 )
 {
 	srand( time( NULL ) );
 	vm_init();
@@ -453,6 +472,11 @@ void FeVM::remove_signal_handler( Sqrat::Object func, const char *slot )
 
 void FeVM::vm_close()
 {
+	m_magic_fns.clear();
+	m_magic_index.clear();
+	m_magic_vm = NULL;
+	m_magic_serial++;
+
 	HSQUIRRELVM vm = Sqrat::DefaultVM::Get();
 	if ( vm )
 	{
@@ -480,6 +504,51 @@ void FeVM::vm_init()
 	fe_register_global_func( vm, zip_get_dir, "zip_get_dir" );
 
 	Sqrat::DefaultVM::Set( vm );
+	m_magic_vm = vm;
+}
+
+bool FeVM::get_magic_fn( HSQUIRRELVM vm,
+	const FeTextTemplate::Magic &m,
+	Sqrat::Function &fn,
+	int &nparams )
+{
+	if ( vm != m_magic_vm )
+	{
+		// Not the layout vm (i.e. a FeConfigVM), don't cache anything
+		fn = Sqrat::Function( Sqrat::RootTable(), m.name.c_str() );
+		if ( fn.IsNull() )
+			return false;
+
+		nparams = fe_get_num_params( vm, fn.GetFunc(), fn.GetEnv() );
+		return true;
+	}
+
+	if ( m.serial != m_magic_serial )
+	{
+		std::map< std::string, int >::iterator itr = m_magic_index.find( m.name );
+		if ( itr == m_magic_index.end() )
+		{
+			// Functions that can't be found aren't remembered, the script
+			// can still go on to define them
+			FeMagicFn mf;
+			mf.fn = Sqrat::Function( Sqrat::RootTable(), m.name.c_str() );
+			if ( mf.fn.IsNull() )
+				return false;
+
+			mf.nparams = fe_get_num_params( vm, mf.fn.GetFunc(), mf.fn.GetEnv() );
+
+			itr = m_magic_index.insert(
+				std::pair< std::string, int >( m.name, m_magic_fns.size() ) ).first;
+			m_magic_fns.push_back( mf );
+		}
+
+		m.slot = itr->second;
+		m.serial = m_magic_serial;
+	}
+
+	fn = m_magic_fns[ m.slot ].fn;
+	nparams = m_magic_fns[ m.slot ].nparams;
+	return true;
 }
 
 void FeVM::update_to_new_list( int var, bool reset_display )
@@ -812,6 +881,7 @@ bool FeVM::on_new_layout()
 		.Prop( _SC("filter_index"), &FePresent::get_filter_index, &FePresent::set_filter_index )
 		.Prop( _SC("search_rule"), &FePresent::get_search_rule, &FePresent::set_search_rule )
 		.Prop( _SC("size"), &FePresent::get_current_filter_size )
+		.Func( _SC("type_ahead"), &FePresent::type_ahead )
 
 		// The following are deprecated as of version 1.5 in favour of using the fe.filters array:
 		.Prop( _SC("filter"), &FePresent::get_filter_name )	// deprecated as of 1.5
@@ -871,7 +941,7 @@ bool FeVM::on_new_layout()
 	fe.Bind( _SC("Filter"), Class <FeFilter, NoConstructor>()
 		.Prop( _SC("name"), &FeFilter::get_name )
 		.Prop( _SC("index"), &FeFilter::get_rom_index )
-		.Prop( _SC("size"), &FeFilter::get_size )
+		.GlobalProp( _SC("size"), &FeVM::cb_get_filter_size )
 		.Prop( _SC("sort_by"), &FeFilter::get_sort_by )
 		.Prop( _SC("reverse_order"), &FeFilter::get_reverse_order )
 		.Prop( _SC("list_limit"), &FeFilter::get_list_limit )
@@ -1091,6 +1161,14 @@ bool FeVM::on_new_layout()
 	fe.SetValue( _SC("script_file"), "" );
 	m_script_cfg = NULL;
 
+	int cache_hits;
+	sf::Time cache_saved;
+	FeScriptCache::get_ref().take_stats( cache_hits, cache_saved );
+
+	if ( cache_hits > 0 )
+		FeLog() << " - Loaded " << cache_hits << " compiled script(s) from cache, saved "
+			<< cache_saved.asMilliseconds() << " ms compiling" << std::endl;
+
 	if ( !skip_layout && ( ps == FeSettings::Layout_Showing ))
 	{
 		FeLog() << " - Loaded layout: " << rep_path
@@ -1415,30 +1493,53 @@ void FePresent::script_process_magic_strings( std::string &str,
 		int filter_offset,
 		int index_offset )
 {
-	HSQUIRRELVM vm = Sqrat::DefaultVM::Get();
-	if ( !vm )
+	if ( str.find( "[!" ) == std::string::npos )
 		return;
 
-	const char *TOK = "[!";
-	int TOK_LEN = 2;
+	FeTextTemplate t( str );
+	std::string out;
+
+	script_process_magic_strings( t, out, filter_offset, index_offset );
+	str.swap( out );
+}
+
+void FePresent::script_process_magic_strings( const FeTextTemplate &t,
+		std::string &out,
+		int filter_offset,
+		int index_offset )
+{
+	const std::string &format = t.get_format();
+	const std::vector<FeTextTemplate::Magic> &magic = t.get_magic();
 
-	size_t pos = str.find( TOK );
-	while ( pos != std::string::npos )
+	HSQUIRRELVM vm = Sqrat::DefaultVM::Get();
+	if ( !vm || magic.empty() )
 	{
-		size_t end = str.find_first_of( ']', pos + TOK_LEN );
-		if ( end == std::string::npos )
-			break;
+		out = format;
+		return;
+	}
+
+	FeVM *fev = (FeVM *)sq_getforeignptr( vm );
 
-		std::string magic = str.substr( pos + TOK_LEN, end-pos-TOK_LEN );
+	out.clear();
+	size_t lit = 0;
+
+	for ( std::vector<FeTextTemplate::Magic>::const_iterator itr = magic.begin();
+			itr != magic.end(); ++itr )
+	{
+		// skip tokens that start inside of one that was already replaced
+		if ( (*itr).pos < lit )
+			continue;
 
 		try
 		{
-			Sqrat::Function func( Sqrat::RootTable(), magic.c_str() );
-			if ( !func.IsNull() )
+			Sqrat::Function func;
+			int nparams( 0 );
+
+			if ( fev && fev->get_magic_fn( vm, *itr, func, nparams ) )
 			{
-				std::string result;
+				const char *result;
 
-				switch ( fe_get_num_params( vm, func.GetFunc(), func.GetEnv() ) )
+				switch ( nparams )
 				{
 				case 2:
 					result = func.Evaluate<const char *>( index_offset, filter_offset );
@@ -1451,26 +1552,27 @@ void FePresent::script_process_magic_strings( std::string &str,
 					break;
 				}
 
-				str.replace( pos, end-pos+1, result );
-				pos += result.size();
+				out.append( format, lit, (*itr).pos - lit );
+				if ( result )
+					out.append( result );
+
+				lit = (*itr).pos + (*itr).len;
 			}
 			else
 			{
 				FeDebug() << "Potential magic string ignored, no corresponding function in script: "
-					<< TOK << magic << "]" << std::endl;
-
-				pos += TOK_LEN;
+					<< "[!" << (*itr).name << "]" << std::endl;
 			}
 		}
 		catch( Sqrat::Exception &e )
 		{
 			FeLog() << "Script Error in magic string function: "
-				<< magic << " - "
+				<< (*itr).name << " - "
 				<< e.Message() << std::endl;
 		}
-
-		pos = str.find( TOK, pos );
 	}
+
+	out.append( format, lit, std::string::npos );
 }
 
 //
@@ -1562,7 +1664,7 @@ public:
 			fe.Bind( _SC("Filter"), Sqrat::Class <FeFilter, Sqrat::NoConstructor>()
 				.Prop( _SC("name"), &FeFilter::get_name )
 				.Prop( _SC("index"), &FeFilter::get_rom_index )
-				.Prop( _SC("size"), &FeFilter::get_size )
+				.GlobalProp( _SC("size"), &FeVM::cb_get_filter_size )
 				.Prop( _SC("sort_by"), &FeFilter::get_sort_by )
 				.Prop( _SC("reverse_order"), &FeFilter::get_reverse_order )
 				.Prop( _SC("list_limit"), &FeFilter::get_list_limit )
@@ -2199,6 +2301,34 @@ int FeVM::cb_get_input_pos( const char *input )
 	return FeInputSingle( input ).get_current_pos();
 }
 
+int FeVM::cb_get_filter_size( FeFilter *f )
+{
+	HSQUIRRELVM vm = Sqrat::DefaultVM::Get();
+	FeVM *fev = (FeVM *)sq_getforeignptr( vm );
+
+	//
+	// The romlist only builds filters other than the current one when they
+	// are first used, so make sure "f" has been built before its size is
+	// read
+	//
+	FeDisplayInfo *di = fev->m_feSettings->get_display(
+		fev->m_feSettings->get_current_display_index() );
+
+	if ( di )
+	{
+		for ( int i=0; i<di->get_filter_count(); i++ )
+		{
+			if ( di->get_filter( i ) == f )
+			{
+				fev->m_feSettings->get_filter_size( i );
+				break;
+			}
+		}
+	}
+
+	return f->get_size();
+}
+
 // return false if file not found
 bool FeVM::internal_do_nut( const std::string &work_dir,
 			const std::string &script_file )
@@ -24,6 +24,7 @@
 #define FE_VM_HPP
 
 #include <vector>
+#include <map>
 #include <queue>
 #include <string>
 
@@ -93,6 +94,23 @@ private:
 	int m_script_id;
 	sf::Time m_last_ui_cmd;
 
+	//
+	// The root table functions that magic tokens have been resolved to, and
+	// the number of parameters each takes.  These are dropped when the vm
+	// is closed, which also bumps m_magic_serial so that the slots that
+	// FeTextTemplates have remembered are no longer used
+	//
+	struct FeMagicFn
+	{
+		Sqrat::Function fn;
+		int nparams;
+	};
+
+	std::vector< FeMagicFn > m_magic_fns;
+	std::map< std::string, int > m_magic_index;
+	HSQUIRRELVM m_magic_vm;
+	int m_magic_serial;
+
 	std::queue< FeInputMap::Command > m_posted_commands;
 	std::vector< FeCallback > m_ticks;
 	std::vector< FeCallback > m_trans;
@@ -131,6 +149,15 @@ public:
 	//
 	void vm_close();
 	void vm_init();
+
+	// Get the function that magic token "m" refers to in "vm" and the number
+	// of parameters it takes.  Returns false if there is no such function
+	//
+	bool get_magic_fn( HSQUIRRELVM vm,
+		const FeTextTemplate::Magic &m,
+		Sqrat::Function &fn,
+		int &nparams );
+
 	bool on_new_layout();
 	bool on_tick();
 	void on_transition( FeTransitionType, int var );
@@ -204,6 +231,7 @@ public:
 	static void cb_remove_signal_handler( const char * );
 	static bool cb_get_input_state( const char *input );
 	static int cb_get_input_pos( const char *input );
+	static int cb_get_filter_size( FeFilter *f );
 	static void do_nut(const char *);
 	static bool load_module( const char *module_file );
 	static bool cb_plugin_command(const char *, const char *, Sqrat::Object, const char * );
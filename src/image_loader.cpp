@@ -0,0 +1,700 @@
+/*
+ *
+ *  Attract-Mode frontend
+ *  Copyright (C) 2020 Andrew Mickelson
+ *
+ *  This file is part of Attract-Mode.
+ *
+ *  Attract-Mode is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Attract-Mode is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Attract-Mode.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "image_loader.hpp"
+#include "fe_base.hpp"
+#include "fe_file.hpp"
+#include "fe_util.hpp"
+#include "zip.hpp"
+#include "nowide/cstdio.hpp"
+
+#include <SFML/Graphics/Image.hpp>
+#include <algorithm>
+#include <iomanip>
+#include <map>
+#include <sstream>
+
+namespace
+{
+	const size_t DEFAULT_CACHE_SIZE = 128 * 1024 * 1024;
+	const char *POSTER_EXT = ".jpg";
+
+	// don't queue up more posters than this for writing
+	const size_t MAX_POSTER_QUEUE = 16;
+
+	// remove "id" from "ids", returns true if it was there
+	bool remove_id( std::vector< int > &ids, int id )
+	{
+		std::vector< int >::iterator itr = std::find( ids.begin(), ids.end(), id );
+		if ( itr == ids.end() )
+			return false;
+
+		ids.erase( itr );
+		return true;
+	}
+};
+
+FeImageLoader &FeImageLoader::get_ref()
+{
+	static FeImageLoader loader;
+	return loader;
+}
+
+FeImageLoader::FeImageLoader()
+	: m_cache_used( 0 ),
+	m_cache_size( DEFAULT_CACHE_SIZE ),
+	m_next_id( 1 ),
+	m_running( false )
+{
+}
+
+FeImageLoader::~FeImageLoader()
+{
+	{
+		sf::Lock l( m_mutex );
+		m_running = false;
+	}
+
+	for ( size_t i=0; i<m_threads.size(); i++ )
+		m_work.post();
+
+	for ( std::vector< sf::Thread * >::iterator itr=m_threads.begin(); itr!=m_threads.end(); ++itr )
+	{
+		(*itr)->wait();
+		delete (*itr);
+	}
+}
+
+void FeImageLoader::start_threads()
+{
+	// leave a processor for the main thread, and don't go overboard
+	int count = std::max( 1, std::min( get_processor_count() - 1, 4 ) );
+
+	m_running = true;
+	for ( int i=0; i<count; i++ )
+	{
+		m_threads.push_back( new sf::Thread( &FeImageLoader::worker, this ) );
+		m_threads.back()->launch();
+	}
+
+	FeDebug() << "Started " << count << " image decoding thread(s)" << std::endl;
+}
+
+std::string FeImageLoader::get_key( const std::string &path, const std::string &filename )
+{
+	std::string key;
+	sf::Int64 size( 0 ), mtime( 0 );
+
+	//
+	// The size and modification time are part of the key so that a file
+	// that gets replaced (i.e. by the scraper) isn't served from the cache
+	//
+	if ( is_supported_archive( path ) )
+	{
+		key = path + "|" + filename;
+		get_file_info( path, size, mtime );
+	}
+	else
+	{
+		key = path + filename;
+		get_file_info( key, size, mtime );
+	}
+
+	std::ostringstream ss;
+	ss << key << '|' << size << '|' << mtime;
+	return ss.str();
+}
+
+int FeImageLoader::request( const std::string &path, const std::string &filename )
+{
+	sf::Lock l( m_mutex );
+
+	if ( m_threads.empty() )
+		start_threads();
+
+	trim_cache();
+
+	int id = m_next_id++;
+	if ( m_next_id <= 0 )
+		m_next_id = 1;
+
+	std::string key = get_key( path, filename );
+
+	std::map< std::string, CacheEntry >::iterator itc = m_cache.find( key );
+	if ( itc != m_cache.end() )
+	{
+		touch( (*itc).second );
+		(*itc).second.refs++;
+
+		Result &r = m_done[ id ];
+		r.status = Loaded;
+		r.key = key;
+		return id;
+	}
+
+	std::map< std::string, Task >::iterator itp = m_in_progress.find( key );
+	if ( itp != m_in_progress.end() )
+	{
+		(*itp).second.ids.push_back( id );
+		return id;
+	}
+
+	std::deque< Task >::iterator itq;
+	for ( itq=m_queue.begin(); itq!=m_queue.end(); ++itq )
+	{
+		if ( (*itq).key.compare( key ) == 0 )
+		{
+			(*itq).ids.push_back( id );
+			return id;
+		}
+	}
+
+	// promote a matching prefetch to a request
+	for ( itq=m_prefetch.begin(); itq!=m_prefetch.end(); ++itq )
+	{
+		if ( (*itq).key.compare( key ) == 0 )
+		{
+			m_prefetch.erase( itq );
+			break;
+		}
+	}
+
+	Task t;
+	t.key = key;
+	t.path = path;
+	t.filename = filename;
+	t.ids.push_back( id );
+
+	m_queue.push_back( t );
+	m_work.post();
+	return id;
+}
+
+void FeImageLoader::cancel( int id )
+{
+	sf::Lock l( m_mutex );
+
+	std::map< int, Result >::iterator itd = m_done.find( id );
+	if ( itd != m_done.end() )
+	{
+		if ( (*itd).second.status == Loaded )
+		{
+			std::map< std::string, CacheEntry >::iterator itc = m_cache.find( (*itd).second.key );
+			if ( itc != m_cache.end() )
+				(*itc).second.refs--;
+		}
+
+		m_done.erase( itd );
+		return;
+	}
+
+	for ( std::deque< Task >::iterator itq=m_queue.begin(); itq!=m_queue.end(); ++itq )
+	{
+		if ( remove_id( (*itq).ids, id ) )
+		{
+			if ( (*itq).ids.empty() )
+				m_queue.erase( itq );
+
+			return;
+		}
+	}
+
+	// if it is being decoded right now, the image still goes in the cache
+	for ( std::map< std::string, Task >::iterator itp=m_in_progress.begin();
+			itp!=m_in_progress.end(); ++itp )
+	{
+		if ( remove_id( (*itp).second.ids, id ) )
+			return;
+	}
+}
+
+FeImageLoader::Status FeImageLoader::get_result( int id,
+	const sf::Uint8 *&pixels,
+	sf::Vector2u &size,
+	std::string &loaded_name )
+{
+	sf::Lock l( m_mutex );
+
+	std::map< int, Result >::iterator itd = m_done.find( id );
+	if ( itd == m_done.end() )
+		return Pending;
+
+	trim_cache();
+
+	Status s = (*itd).second.status;
+	if ( s == Loaded )
+	{
+		std::map< std::string, CacheEntry >::iterator itc = m_cache.find( (*itd).second.key );
+		if ( itc == m_cache.end() )
+			s = Failed; // shouldn't happen, the entry is held until picked up
+		else
+		{
+			CacheEntry &e = (*itc).second;
+			e.refs--;
+			touch( e );
+
+			pixels = e.pixels.empty() ? NULL : &( e.pixels[0] );
+			size = e.size;
+			loaded_name = e.loaded_name;
+		}
+	}
+
+	m_done.erase( itd );
+	return s;
+}
+
+void FeImageLoader::prefetch( const std::string &path, const std::string &filename )
+{
+	sf::Lock l( m_mutex );
+
+	if ( m_cache_size == 0 )
+		return;
+
+	if ( m_threads.empty() )
+		start_threads();
+
+	trim_cache();
+
+	std::string key = get_key( path, filename );
+
+	std::map< std::string, CacheEntry >::iterator itc = m_cache.find( key );
+	if ( itc != m_cache.end() )
+	{
+		// keep it from being pushed out of the cache
+		touch( (*itc).second );
+		return;
+	}
+
+	if ( m_in_progress.find( key ) != m_in_progress.end() )
+		return;
+
+	std::deque< Task >::iterator itq;
+	for ( itq=m_queue.begin(); itq!=m_queue.end(); ++itq )
+	{
+		if ( (*itq).key.compare( key ) == 0 )
+			return;
+	}
+
+	for ( itq=m_prefetch.begin(); itq!=m_prefetch.end(); ++itq )
+	{
+		if ( (*itq).key.compare( key ) == 0 )
+			return;
+	}
+
+	Task t;
+	t.key = key;
+	t.path = path;
+	t.filename = filename;
+
+	m_prefetch.push_back( t );
+	m_work.post();
+}
+
+void FeImageLoader::clear_prefetch()
+{
+	sf::Lock l( m_mutex );
+	m_prefetch.clear();
+}
+
+void FeImageLoader::set_cache_size( size_t bytes )
+{
+	sf::Lock l( m_mutex );
+	m_cache_size = bytes;
+	trim_cache();
+}
+
+size_t FeImageLoader::get_cache_size() const
+{
+	sf::Lock l( m_mutex );
+	return m_cache_size;
+}
+
+void FeImageLoader::touch( CacheEntry &e )
+{
+	m_lru.splice( m_lru.begin(), m_lru, e.lru );
+}
+
+//
+// Called from the main thread only, so the pixels last handed out by
+// get_result() stay valid until the main thread calls in again
+//
+void FeImageLoader::trim_cache()
+{
+	std::list< std::string >::iterator itr = m_lru.end();
+	while (( m_cache_used > m_cache_size ) && ( itr != m_lru.begin() ))
+	{
+		--itr;
+
+		std::map< std::string, CacheEntry >::iterator itc = m_cache.find( *itr );
+		if ( (*itc).second.refs > 0 )
+			continue;
+
+		m_cache_used -= (*itc).second.pixels.size();
+		m_cache.erase( itc );
+		itr = m_lru.erase( itr );
+	}
+}
+
+bool FeImageLoader::get_next_task( Task &t )
+{
+	sf::Lock l( m_mutex );
+
+	std::deque< Task > *q = &m_queue;
+	if ( q->empty() )
+		q = &m_prefetch;
+
+	if ( q->empty() )
+		return false;
+
+	t = q->front();
+	q->pop_front();
+	m_in_progress[ t.key ] = t;
+	return true;
+}
+
+void FeImageLoader::done_with_task( const std::string &key, Decoded &d )
+{
+	sf::Lock l( m_mutex );
+
+	std::map< std::string, Task >::iterator itp = m_in_progress.find( key );
+	if ( itp == m_in_progress.end() )
+		return;
+
+	std::vector< int > ids;
+	ids.swap( (*itp).second.ids );
+	m_in_progress.erase( itp );
+
+	// a prefetch that was superseded or doesn't fit isn't worth keeping
+	if (( d.status == Loaded ) && ids.empty()
+			&& ( d.pixels.size() > m_cache_size ))
+		return;
+
+	if (( d.status == Loaded ) && ( m_cache.find( key ) == m_cache.end() ))
+	{
+		CacheEntry &e = m_cache[ key ];
+		e.pixels.swap( d.pixels );
+		e.size = d.size;
+		e.loaded_name.swap( d.loaded_name );
+		e.refs = 0;
+		e.lru = m_lru.insert( m_lru.begin(), key );
+
+		m_cache_used += e.pixels.size();
+	}
+
+	for ( std::vector< int >::iterator itr=ids.begin(); itr!=ids.end(); ++itr )
+	{
+		Result &r = m_done[ *itr ];
+		r.status = d.status;
+
+		if ( d.status == Loaded )
+		{
+			r.key = key;
+			m_cache[ key ].refs++;
+		}
+	}
+}
+
+void FeImageLoader::decode( const Task &t, Decoded &d )
+{
+	sf::Image img;
+	d.status = Failed;
+
+	if ( is_supported_archive( t.path ) )
+	{
+		d.loaded_name = t.path + "|" + t.filename;
+
+		if ( !file_exists( t.path ) )
+		{
+			d.status = Missing;
+			return;
+		}
+
+		FeZipStream zs( t.path );
+		if ( !zs.open( t.filename ) )
+		{
+			// Error opening specified filename.  Try to correct
+			// in case filename is in a subdir of the archive
+			std::string temp;
+			if ( get_archive_filename_with_base(
+					temp, t.path, t.filename ) )
+			{
+				zs.open( temp );
+				d.loaded_name = t.path + "|" + temp;
+			}
+		}
+
+		if ( !img.loadFromStream( zs ) )
+			return;
+	}
+	else
+	{
+		d.loaded_name = t.path + t.filename;
+
+		if ( !file_exists( d.loaded_name ) )
+		{
+			d.status = Missing;
+			return;
+		}
+
+		FeFileInputStream filestream( d.loaded_name );
+		if ( !img.loadFromStream( filestream ) )
+			return;
+	}
+
+	d.size = img.getSize();
+	const sf::Uint8 *p = img.getPixelsPtr();
+	if ( p )
+		d.pixels.assign( p, p + d.size.x * d.size.y * 4 );
+
+	d.status = Loaded;
+}
+
+void FeImageLoader::worker( FeImageLoader *l )
+{
+	for ( ;; )
+	{
+		l->m_work.wait();
+
+		{
+			sf::Lock lck( l->m_mutex );
+			if ( !l->m_running )
+				break;
+		}
+
+		// there may be nothing to do if the task was cancelled or taken
+		// by another thread already
+		Task t;
+		if ( l->get_next_task( t ) )
+		{
+			Decoded d;
+			decode( t, d );
+			l->done_with_task( t.key, d );
+		}
+	}
+}
+
+FePosterCache &FePosterCache::get_ref()
+{
+	static FePosterCache cache;
+	return cache;
+}
+
+FePosterCache::FePosterCache()
+	: m_thread( NULL ),
+	m_running( false )
+{
+}
+
+FePosterCache::~FePosterCache()
+{
+	if ( m_thread )
+	{
+		{
+			sf::Lock l( m_mutex );
+			m_running = false;
+		}
+
+		m_work.post();
+		m_thread->wait();
+		delete m_thread;
+	}
+}
+
+void FePosterCache::set_path( const std::string &path )
+{
+	sf::Lock l( m_mutex );
+	m_path = path;
+}
+
+const std::string &FePosterCache::get_path() const
+{
+	return m_path;
+}
+
+bool FePosterCache::get_poster_name( const std::string &path,
+	const std::string &filename,
+	std::string &poster ) const
+{
+	if ( m_path.empty() )
+		return false;
+
+	std::string key;
+	sf::Int64 size, mtime;
+
+	if ( is_supported_archive( path ) )
+	{
+		key = path + "|" + filename;
+		if ( !get_file_info( path, size, mtime ) )
+			return false;
+	}
+	else
+	{
+		key = path + filename;
+		if ( !get_file_info( key, size, mtime ) )
+			return false;
+	}
+
+	// 64-bit FNV-1a hash of the name
+	sf::Uint64 hash = 14695981039346656037ULL;
+	for ( std::string::const_iterator itr=key.begin(); itr!=key.end(); ++itr )
+	{
+		hash ^= (unsigned char)(*itr);
+		hash *= 1099511628211ULL;
+	}
+
+	std::ostringstream ss;
+	ss << std::hex << std::setfill( '0' ) << std::setw( 16 ) << hash
+		<< std::dec << '-' << size << '-' << mtime << POSTER_EXT;
+	poster = ss.str();
+	return true;
+}
+
+bool FePosterCache::find( const std::string &path,
+	const std::string &filename,
+	std::string &poster )
+{
+	if ( !get_poster_name( path, filename, poster ) )
+		return false;
+
+	return file_exists( m_path + poster );
+}
+
+void FePosterCache::store( const std::string &path,
+	const std::string &filename,
+	const sf::Uint8 *pixels,
+	const sf::Vector2u &size )
+{
+	if (( !pixels ) || ( size.x == 0 ) || ( size.y == 0 ))
+		return;
+
+	Task t;
+	if ( !get_poster_name( path, filename, t.poster ) )
+		return;
+
+	t.pixels.assign( pixels, pixels + size.x * size.y * 4 );
+	t.size = size;
+
+	sf::Lock l( m_mutex );
+
+	if ( m_queue.size() >= MAX_POSTER_QUEUE )
+		return;
+
+	m_queue.push_back( t );
+	m_work.post();
+
+	if ( !m_thread )
+	{
+		m_running = true;
+		m_thread = new sf::Thread( &FePosterCache::worker, this );
+		m_thread->launch();
+	}
+}
+
+void FePosterCache::worker( FePosterCache *c )
+{
+	//
+	// The current poster for each video (by name hash) in the poster
+	// directory, read once so that writing a poster never has to list
+	// the directory
+	//
+	std::map< std::string, std::string > current;
+	std::string current_path;
+	bool scanned=false;
+
+	for ( ;; )
+	{
+		Task t;
+		std::string path;
+		bool found=false;
+
+		c->m_work.wait();
+
+		{
+			sf::Lock l( c->m_mutex );
+			if ( !c->m_running )
+				break;
+
+			if ( !c->m_queue.empty() )
+			{
+				t.poster.swap( c->m_queue.front().poster );
+				t.pixels.swap( c->m_queue.front().pixels );
+				t.size = c->m_queue.front().size;
+				c->m_queue.pop_front();
+				path = c->m_path;
+				found = true;
+			}
+		}
+
+		if ( !found )
+			continue;
+
+		if ( !scanned || ( path.compare( current_path ) != 0 ))
+		{
+			current.clear();
+			current_path = path;
+			scanned = true;
+
+			std::vector< std::string > list;
+			get_basename_from_extension( list, path, POSTER_EXT, false );
+
+			for ( std::vector< std::string >::iterator itr=list.begin(); itr!=list.end(); ++itr )
+			{
+				size_t pos = (*itr).find( '-' );
+				if (( pos != std::string::npos ) && ( (*itr)[0] != '~' ))
+					current[ (*itr).substr( 0, pos ) ] = *itr;
+			}
+		}
+
+		//
+		// Write to a temporary file first and then rename it, so that a
+		// partly written poster never gets loaded
+		//
+		std::string tmp_name = path + "~" + t.poster;
+
+		sf::Image img;
+		img.create( t.size.x, t.size.y, &(t.pixels[0]) );
+
+		if ( !img.saveToFile( tmp_name ) )
+		{
+			FeDebug() << "Error writing video poster: " << tmp_name << std::endl;
+			delete_file( tmp_name );
+			continue;
+		}
+
+		if ( nowide::rename( tmp_name.c_str(), ( path + t.poster ).c_str() ) != 0 )
+		{
+			delete_file( tmp_name );
+			continue;
+		}
+
+		//
+		// Delete the poster for the earlier version of the same video.  It
+		// has the same name hash but a different size or modification time
+		//
+		std::string &old_poster = current[ t.poster.substr( 0, t.poster.find( '-' ) ) ];
+
+		if ( !old_poster.empty() && ( old_poster.compare( t.poster ) != 0 ))
+			delete_file( path + old_poster );
+
+		old_poster = t.poster;
+	}
+}
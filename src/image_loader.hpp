@@ -0,0 +1,229 @@
+/*
+ *
+ *  Attract-Mode frontend
+ *  Copyright (C) 2020 Andrew Mickelson
+ *
+ *  This file is part of Attract-Mode.
+ *
+ *  Attract-Mode is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Attract-Mode is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Attract-Mode.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef IMAGE_LOADER_HPP
+#define IMAGE_LOADER_HPP
+
+#include <SFML/System.hpp>
+#include "fe_util.hpp"
+#include <string>
+#include <deque>
+#include <list>
+#include <map>
+#include <vector>
+
+//
+// Pool of worker threads that decode images in the background.  The main
+// thread queues a request and then polls for the result, which it uploads
+// to a texture itself (textures can only be touched by the main thread).
+//
+// Decoded images are kept in a cache up to a memory budget, so images
+// that were shown recently (or prefetched) don't have to be decoded again.
+// Images are keyed on their file's size and modification time as well as
+// its name, so a file that changes gets decoded again.
+//
+class FeImageLoader
+{
+public:
+	enum Status
+	{
+		Pending,	// still queued or being decoded
+		Loaded,	// decoded image is ready
+		Failed,	// file exists but couldn't be decoded
+		Missing	// file (or archive) doesn't exist
+	};
+
+	static FeImageLoader &get_ref();
+
+	~FeImageLoader();
+
+	//
+	// Queue "filename" for decoding.  If "path" is a supported archive then
+	// filename is read from the archive, otherwise "path" is a directory
+	// that is prepended to filename.
+	//
+	// returns the (non-zero) request id
+	//
+	int request( const std::string &path, const std::string &filename );
+
+	//
+	// Drop a request that is no longer wanted.  If it hasn't been decoded
+	// yet then it won't be.
+	//
+	void cancel( int id );
+
+	//
+	// Check on request "id".  Once this returns something other than
+	// Pending the request is finished and "id" is no longer valid.
+	//
+	// On Loaded, "pixels" points to the decoded RGBA pixels (which stay
+	// valid until the next call to request(), get_result() or prefetch()),
+	// "size" gets the image size and "loaded_name" the name of what was
+	// loaded (as used by FeTextureContainer::get_file_name())
+	//
+	Status get_result( int id,
+		const sf::Uint8 *&pixels,
+		sf::Vector2u &size,
+		std::string &loaded_name );
+
+	//
+	// Decode "filename" into the cache if it isn't there already.
+	// Prefetches are only worked on when there are no requests waiting.
+	//
+	void prefetch( const std::string &path, const std::string &filename );
+
+	// drop the prefetches that haven't been started yet
+	void clear_prefetch();
+
+	// memory budget (in bytes) for the decoded image cache
+	void set_cache_size( size_t bytes );
+	size_t get_cache_size() const;
+
+private:
+	FeImageLoader();
+	FeImageLoader( const FeImageLoader & );
+	FeImageLoader &operator=( const FeImageLoader & );
+
+	struct Task
+	{
+		std::string key;
+		std::string path;
+		std::string filename;
+		std::vector< int > ids; // requests waiting on this, empty for a prefetch
+	};
+
+	struct Decoded
+	{
+		Status status;
+		std::vector< sf::Uint8 > pixels;
+		sf::Vector2u size;
+		std::string loaded_name;
+	};
+
+	struct Result
+	{
+		Status status;
+		std::string key; // cache key of the decoded image if Loaded
+	};
+
+	struct CacheEntry
+	{
+		std::vector< sf::Uint8 > pixels;
+		sf::Vector2u size;
+		std::string loaded_name;
+		int refs; // finished requests that haven't been picked up yet
+		std::list< std::string >::iterator lru;
+	};
+
+	mutable sf::Mutex m_mutex;
+	std::deque< Task > m_queue;
+	std::deque< Task > m_prefetch;
+	std::map< std::string, Task > m_in_progress; // by key
+	std::map< int, Result > m_done;
+	std::map< std::string, CacheEntry > m_cache;
+	std::list< std::string > m_lru; // cache keys, most recently used first
+	size_t m_cache_used;
+	size_t m_cache_size;
+	std::vector< sf::Thread * > m_threads;
+	FeSemaphore m_work; // posted for each task queued, and to stop the threads
+	int m_next_id;
+	bool m_running;
+
+	void start_threads();
+	void touch( CacheEntry &e );
+	void trim_cache();
+	bool get_next_task( Task &t );
+	void done_with_task( const std::string &key, Decoded &d );
+
+	static std::string get_key( const std::string &path, const std::string &filename );
+	static void decode( const Task &t, Decoded &d );
+	static void worker( FeImageLoader *l );
+};
+
+//
+// Persistent cache of "poster" images for videos: the first frame of each
+// video, saved as an image the first time the video gets opened.  The
+// poster can be shown right away the next time the video is selected,
+// while opening the video itself waits until navigation settles.
+//
+// Posters are keyed on the video's path, size and modification time, so
+// a changed video gets a new poster (and the old one is deleted).  Videos
+// in archives are keyed on the archive.
+//
+class FePosterCache
+{
+public:
+	static FePosterCache &get_ref();
+
+	~FePosterCache();
+
+	// directory to keep posters in.  Nothing is cached until this is set
+	void set_path( const std::string &path );
+	const std::string &get_path() const;
+
+	//
+	// Get the poster for the video "filename" in "path" (an archive or a
+	// directory to prepend to filename).  "poster" gets the poster's
+	// filename within get_path()
+	//
+	// returns false if there isn't a poster for the video
+	//
+	bool find( const std::string &path,
+		const std::string &filename,
+		std::string &poster );
+
+	//
+	// Save "pixels" (RGBA) as the poster for the video.  The image is
+	// encoded and written in the background.
+	//
+	void store( const std::string &path,
+		const std::string &filename,
+		const sf::Uint8 *pixels,
+		const sf::Vector2u &size );
+
+private:
+	FePosterCache();
+	FePosterCache( const FePosterCache & );
+	FePosterCache &operator=( const FePosterCache & );
+
+	struct Task
+	{
+		std::string poster;
+		std::vector< sf::Uint8 > pixels;
+		sf::Vector2u size;
+	};
+
+	sf::Mutex m_mutex;
+	std::deque< Task > m_queue;
+	std::string m_path;
+	sf::Thread *m_thread;
+	FeSemaphore m_work; // posted for each poster queued, and to stop the thread
+	bool m_running;
+
+	bool get_poster_name( const std::string &path,
+		const std::string &filename,
+		std::string &poster ) const;
+
+	static void worker( FePosterCache *c );
+};
+
+#endif
@@ -24,6 +24,7 @@
 #include "zip.hpp"
 #include "fe_base.hpp"
 #include "fe_file.hpp"
+#include "fe_util.hpp"
 #include <SFML/System.hpp>
 #include <SFML/Graphics.hpp>
 
@@ -71,7 +72,8 @@ extern "C"
 
 }
 
-#include <queue>
+#include <vector>
+#include <algorithm>
 #include <iostream>
 
 //
@@ -124,9 +126,134 @@ public:
 	AVFormatContext *m_format_ctx;
 	AVIOContext *m_io_ctx;
 	sf::Mutex m_read_mutex;
+	AVPacket *m_read_packet; // next packet to read into, protected by m_read_mutex
 	bool m_read_eof;
 };
 
+//
+// Bounded single producer/single consumer queue.  push() and pop() don't
+// lock, so long as there is only ever one thread pushing and one thread
+// popping at a time.
+//
+#if defined( __clang__ ) || ( __GNUC__ > 4 ) || (( __GNUC__ == 4 ) && ( __GNUC_MINOR__ >= 7 ))
+ inline size_t fe_load_acquire( const volatile size_t *p ) { return __atomic_load_n( p, __ATOMIC_ACQUIRE ); }
+ inline void fe_store_release( volatile size_t *p, size_t v ) { __atomic_store_n( p, v, __ATOMIC_RELEASE ); }
+ inline size_t fe_exchange( volatile size_t *p, size_t v ) { return __atomic_exchange_n( p, v, __ATOMIC_ACQ_REL ); }
+#else
+ inline size_t fe_load_acquire( const volatile size_t *p ) { size_t v = *p; __sync_synchronize(); return v; }
+ inline void fe_store_release( volatile size_t *p, size_t v ) { __sync_synchronize(); *p = v; }
+ inline size_t fe_exchange( volatile size_t *p, size_t v ) { __sync_synchronize(); return __sync_lock_test_and_set( p, v ); }
+#endif
+
+template< class T >
+class FeSpscQueue
+{
+public:
+	// "size" must be a power of 2
+	FeSpscQueue( size_t size )
+		: m_buf( size ), m_mask( size - 1 ), m_head( 0 ), m_tail( 0 )
+	{
+	}
+
+	// returns false if the queue is full
+	bool push( const T &v )
+	{
+		size_t tail = m_tail;
+		if ( tail - fe_load_acquire( &m_head ) > m_mask )
+			return false;
+
+		m_buf[ tail & m_mask ] = v;
+		fe_store_release( &m_tail, tail + 1 );
+		return true;
+	}
+
+	// returns false if the queue is empty
+	bool pop( T &v )
+	{
+		size_t head = m_head;
+		if ( head == fe_load_acquire( &m_tail ) )
+			return false;
+
+		v = m_buf[ head & m_mask ];
+		fe_store_release( &m_head, head + 1 );
+		return true;
+	}
+
+private:
+	FeSpscQueue( const FeSpscQueue & );
+	FeSpscQueue &operator=( const FeSpscQueue & );
+
+	std::vector< T > m_buf;
+	size_t m_mask;
+	volatile size_t m_head; // only written by the consumer
+	volatile size_t m_tail; // only written by the producer
+};
+
+//
+// Index juggling for triple buffered handoff of frames from a producer
+// thread to a consumer thread, without locking.  The producer fills the
+// "back" buffer and publishes it, the consumer fetches the most recently
+// published buffer which then becomes its "front" buffer.  Neither side
+// ever waits for the other.
+//
+class FeTripleBuffer
+{
+public:
+	FeTripleBuffer()
+		: m_back( 0 ), m_front( 1 ), m_middle( 2 )
+	{
+	}
+
+	// producer: the buffer to fill next
+	int back() const { return (int)m_back; }
+
+	//
+	// producer: publish the back buffer.  returns true if this replaced
+	// a published buffer that the consumer never fetched
+	//
+	bool publish()
+	{
+		size_t old = fe_exchange( &m_middle, m_back | DIRTY );
+		m_back = old & INDEX_MASK;
+		return ( old & DIRTY ) != 0;
+	}
+
+	//
+	// consumer: fetch the most recently published buffer.  returns false
+	// if nothing new has been published since the last fetch
+	//
+	bool fetch()
+	{
+		if ( !( fe_load_acquire( &m_middle ) & DIRTY ) )
+			return false;
+
+		size_t old = fe_exchange( &m_middle, m_front );
+		m_front = old & INDEX_MASK;
+		return ( old & DIRTY ) != 0;
+	}
+
+	// consumer: the buffer fetched last
+	int front() const { return (int)m_front; }
+
+	//
+	// either side: drop the published buffer if it hasn't been fetched
+	//
+	void discard()
+	{
+		size_t m = fe_load_acquire( &m_middle );
+		while (( m & DIRTY )
+				&& ( !__sync_bool_compare_and_swap( &m_middle, m, m & INDEX_MASK ) ))
+			m = fe_load_acquire( &m_middle );
+	}
+
+private:
+	enum { INDEX_MASK=0x3, DIRTY=0x4 };
+
+	size_t m_back; // only used by the producer
+	size_t m_front; // only used by the consumer
+	volatile size_t m_middle; // last published buffer, and DIRTY if not fetched yet
+};
+
 //
 // Base class for our implementation of the audio and video components
 //
@@ -134,10 +261,21 @@ class FeBaseStream
 {
 private:
 	//
-	// Queue containing the next packet to process for this stream
+	// Queue containing the next packets to process for this stream.  The
+	// producer is whoever holds FeMediaImp::m_read_mutex, the consumer is
+	// the thread decoding this stream.
+	//
+	FeSpscQueue< AVPacket * > m_packetq;
+
+	//
+	// Used packets, handed back by the consumer for the reader to reuse
 	//
-	std::queue <AVPacket *> m_packetq;
-	sf::Mutex m_packetq_mutex;
+	FeSpscQueue< AVPacket * > m_free_packets;
+
+	//
+	// Used frames kept for reuse by the thread decoding this stream
+	//
+	std::vector< AVFrame * > m_free_frames;
 
 public:
 	virtual ~FeBaseStream();
@@ -150,12 +288,26 @@ public:
 
 	FeBaseStream();
 	virtual void stop();
+
+	// consumer side
 	AVPacket *pop_packet();
-	void push_packet( AVPacket *pkt );
+	void release_packet( AVPacket *pkt ); // done with a popped packet
 	void clear_packet_queue();
 
+	// producer side, push_packet() returns false if the queue is full
+	bool push_packet( AVPacket *pkt );
+	AVPacket *get_free_packet(); // NULL if there are none to reuse
+
+	//
+	// Get a frame to decode into, and hand it back when done with it.
+	// Only to be used by the thread decoding this stream.
+	//
+	AVFrame *alloc_frame();
+	void release_frame( AVFrame *frame );
+
 	// Utility functions to free AV stuff...
 	//
+	static void unref_packet( AVPacket *pkt );
 	static void free_packet( AVPacket *pkt );
 	static void free_frame( AVFrame *frame );
 };
@@ -183,14 +335,21 @@ class FeVideoImp : public FeBaseStream
 {
 private:
 	//
-	// Video decoding and colour conversion runs on a dedicated thread.
+	// Video decoding and colour conversion is done on the worker threads
+	// of the FeVideoScheduler, which are shared by all playing videos.
 	// Loading the result into an sf::Texture and displaying it is done
 	// on the main thread.
 	//
-	sf::Thread m_video_thread;
 	FeMedia *m_parent;
-	sf::Uint8 *rgba_buffer[4];
-	int rgba_linesize[4];
+
+	//
+	// Decoding state, carried between calls to decode_step()
+	//
+	AVFrame *detached_frame;
+	bool degrading;
+	int64_t prev_pts;
+	int64_t prev_duration;
+	sf::Time wait_time;
 
 #if FE_HWACCEL
 	AVPixelFormat hwaccel_output_format;
@@ -198,7 +357,7 @@ private:
 #endif
 
 public:
-	bool run_video_thread;
+	bool playing;
 	sf::Time time_base;
 	sf::Time max_sleep;
 	sf::Clock video_timer;
@@ -209,11 +368,23 @@ public:
 	int disptex_height;
 
 	//
-	// The video thread sets display_frame when the next image frame is decoded.
-	// The main thread then copies the image into the corresponding sf::Texture.
+	// The decoding thread colour converts each frame into the back buffer
+	// of "frames" and publishes it.  The main thread then copies the latest
+	// published image into the corresponding sf::Texture.
 	//
-	sf::Mutex image_swap_mutex;
-	sf::Uint8 *display_frame;
+	sf::Uint8 *rgba_buffer[3][4];
+	int rgba_linesize[4];
+	FeTripleBuffer frames;
+	bool preloaded; // the back buffer holds the first frame (until play())
+
+	//
+	// Decoding statistics, logged by finish()
+	//
+	int qscore; // quality scoring
+	int displayed;
+	int qscore_accum;
+	int late; // frames that were converted after they were due
+	int skipped; // frames replaced by a newer one before being shown
 
 	FeVideoImp( FeMedia *parent );
 	~FeVideoImp();
@@ -222,13 +393,80 @@ public:
 	void stop();
 
 	void preload();
-	void video_thread();
+
+	//
+	// Do the next bit of decoding work (decode a packet or display a
+	// frame).  Called by the scheduler, never by two threads at once.
+	//
+	// returns false once the video is done.  Otherwise "next" is set
+	// to how long to wait before calling again.
+	//
+	bool decode_step( sf::Time &next );
+
+	// clean up once decoding is done
+	void finish();
+};
+
+//
+// Schedules the decoding of all playing videos on a fixed pool of worker
+// threads.  Each worker services whichever video has the earliest
+// deadline, so the number of decoding threads depends on the number of
+// processors rather than the number of videos being shown.
+//
+class FeVideoScheduler
+{
+public:
+	static FeVideoScheduler &get_ref();
+
+	~FeVideoScheduler();
+
+	// start scheduling "v"
+	void add( FeVideoImp *v );
+
+	//
+	// Stop scheduling "v", waiting for a worker that is in the middle of
+	// decoding it.  returns false if "v" wasn't scheduled (because it had
+	// already finished)
+	//
+	bool remove( FeVideoImp *v );
+
+private:
+	FeVideoScheduler();
+	FeVideoScheduler( const FeVideoScheduler & );
+	FeVideoScheduler &operator=( const FeVideoScheduler & );
+
+	struct Slot
+	{
+		FeVideoImp *video;
+		sf::Time due;
+		bool busy;
+		bool removing; // remove() is waiting for the busy worker to finish
+	};
+
+	sf::Mutex m_mutex;
+	std::vector< Slot > m_slots;
+	std::vector< sf::Thread * > m_threads;
+	FeSemaphore m_wake; // posted when a video is added, and to stop the threads
+	FeSemaphore m_released; // posted when a slot that remove() is waiting on is released
+	sf::Clock m_clock;
+	bool m_running;
+
+	void start_threads();
+
+	// returns the next video to work on.  If there isn't one, returns NULL
+	// and sets "wait" to how long until one is due, or to sf::Time::Zero
+	// if there are no videos to wait for
+	FeVideoImp *get_next( sf::Time &wait );
+	void done_with( FeVideoImp *v, bool keep, const sf::Time &next );
+
+	static void worker( FeVideoScheduler *s );
 };
 
 FeMediaImp::FeMediaImp( FeMedia::Type t )
 	: m_type( t ),
 	m_format_ctx( NULL ),
 	m_io_ctx( NULL ),
+	m_read_packet( NULL ),
 	m_read_eof( false )
 {
 }
@@ -255,12 +493,31 @@ void FeMediaImp::close()
 		m_io_ctx=NULL;
 	}
 
+	if ( m_read_packet )
+	{
+		FeBaseStream::free_packet( m_read_packet );
+		m_read_packet=NULL;
+	}
 
 	m_read_eof=false;
 }
 
+namespace
+{
+	//
+	// Packets that can be queued up for a stream.  Reading only continues
+	// while some stream is short of packets, so this is only reached if a
+	// stream stops being decoded while another one keeps reading.
+	//
+	const size_t PACKET_QUEUE_SIZE = 1024;
+	const size_t FREE_PACKETS_SIZE = 64;
+	const size_t FREE_FRAMES_SIZE = 4;
+};
+
 FeBaseStream::FeBaseStream()
-	: at_end( false ),
+	: m_packetq( PACKET_QUEUE_SIZE ),
+	m_free_packets( FREE_PACKETS_SIZE ),
+	at_end( false ),
 	far_behind( false ),
 	codec_ctx( NULL ),
 	codec( NULL ),
@@ -278,6 +535,16 @@ FeBaseStream::~FeBaseStream()
 
 	clear_packet_queue();
 
+	AVPacket *p;
+	while ( m_free_packets.pop( p ) )
+		free_packet( p );
+
+	for ( std::vector< AVFrame * >::iterator itr=m_free_frames.begin();
+			itr!=m_free_frames.end(); ++itr )
+		free_frame( *itr );
+
+	m_free_frames.clear();
+
 	codec = NULL;
 	at_end = false;
 	far_behind = false;
@@ -293,41 +560,85 @@ void FeBaseStream::stop()
 
 AVPacket *FeBaseStream::pop_packet()
 {
-	sf::Lock l( m_packetq_mutex );
-
-	if ( m_packetq.empty() )
+	AVPacket *p;
+	if ( !m_packetq.pop( p ) )
 		return NULL;
 
-	AVPacket *p = m_packetq.front();
-	m_packetq.pop();
 	return p;
 }
 
+void FeBaseStream::release_packet( AVPacket *pkt )
+{
+	unref_packet( pkt );
+
+	if ( !m_free_packets.push( pkt ) )
+		av_free( pkt );
+}
+
 void FeBaseStream::clear_packet_queue()
 {
-	sf::Lock l( m_packetq_mutex );
+	AVPacket *p;
+	while ( m_packetq.pop( p ) )
+		release_packet( p );
+}
+
+bool FeBaseStream::push_packet( AVPacket *pkt )
+{
+	return m_packetq.push( pkt );
+}
 
-	while ( !m_packetq.empty() )
+AVPacket *FeBaseStream::get_free_packet()
+{
+	AVPacket *p;
+	if ( !m_free_packets.pop( p ) )
+		return NULL;
+
+	return p;
+}
+
+AVFrame *FeBaseStream::alloc_frame()
+{
+	if ( !m_free_frames.empty() )
 	{
-		AVPacket *p = m_packetq.front();
-		m_packetq.pop();
-		free_packet( p );
+		AVFrame *f = m_free_frames.back();
+		m_free_frames.pop_back();
+		return f;
 	}
+
+#if (LIBAVCODEC_VERSION_INT >= AV_VERSION_INT( 55, 45, 0 ))
+	m_free_frames.reserve( FREE_FRAMES_SIZE );
+	return av_frame_alloc();
+#else
+	return avcodec_alloc_frame();
+#endif
 }
 
-void FeBaseStream::push_packet( AVPacket *pkt )
+void FeBaseStream::release_frame( AVFrame *frame )
 {
-	sf::Lock l( m_packetq_mutex );
-	m_packetq.push( pkt );
+#if (LIBAVCODEC_VERSION_INT >= AV_VERSION_INT( 55, 45, 0 ))
+	if ( m_free_frames.size() < FREE_FRAMES_SIZE )
+	{
+		av_frame_unref( frame );
+		m_free_frames.push_back( frame );
+		return;
+	}
+#endif
+
+	free_frame( frame );
 }
 
-void FeBaseStream::free_packet( AVPacket *pkt )
+void FeBaseStream::unref_packet( AVPacket *pkt )
 {
 #if (LIBAVCODEC_VERSION_INT >= AV_VERSION_INT( 55, 16, 0 ))
 	av_packet_unref( pkt );
 #else
 	av_free_packet( pkt );
 #endif
+}
+
+void FeBaseStream::free_packet( AVPacket *pkt )
+{
+	unref_packet( pkt );
 	av_free( pkt );
 }
 
@@ -375,20 +686,28 @@ FeAudioImp::~FeAudioImp()
 
 FeVideoImp::FeVideoImp( FeMedia *p )
 		: FeBaseStream(),
-		m_video_thread( &FeVideoImp::video_thread, this ),
 		m_parent( p ),
-		rgba_buffer(),
-		rgba_linesize(),
+		detached_frame( NULL ),
+		degrading( false ),
+		prev_pts( 0 ),
+		prev_duration( 0 ),
 #if FE_HWACCEL
 		hwaccel_output_format( AV_PIX_FMT_NONE ),
 #endif
-		run_video_thread( false ),
+		playing( false ),
 		display_texture( NULL ),
 		sws_ctx( NULL ),
 		sws_flags( SWS_BILINEAR ),
 		disptex_width( 0 ),
 		disptex_height( 0 ),
-		display_frame( NULL )
+		rgba_buffer(),
+		rgba_linesize(),
+		preloaded( false ),
+		qscore( 10 ),
+		displayed( 0 ),
+		qscore_accum( 0 ),
+		late( 0 ),
+		skipped( 0 )
 {
 }
 
@@ -396,8 +715,11 @@ FeVideoImp::~FeVideoImp()
 {
 	stop();
 
-	if (rgba_buffer[0])
-		av_freep(&rgba_buffer[0]);
+	for ( int i=0; i<3; i++ )
+	{
+		if (rgba_buffer[i][0])
+			av_freep(&rgba_buffer[i][0]);
+	}
 
 	if (sws_ctx)
 		sws_freeContext(sws_ctx);
@@ -433,7 +755,7 @@ bool FeVideoImp::hw_retrieve_data( AVFrame *f )
 	if ( !(av_pix_fmt_desc_get( (AVPixelFormat)f->format )->flags & AV_PIX_FMT_FLAG_HWACCEL) )
 		return false;
 
-	AVFrame *sw_frame = av_frame_alloc();
+	AVFrame *sw_frame = alloc_frame();
 	if ( hwaccel_output_format == AV_PIX_FMT_NONE )
 	{
 		hwaccel_output_format = hw_get_output_format( codec_ctx->hw_frames_ctx );
@@ -454,7 +776,7 @@ bool FeVideoImp::hw_retrieve_data( AVFrame *f )
 
 	av_frame_unref( f );
 	av_frame_move_ref( f, sw_frame );
-	av_frame_free( &sw_frame );
+	release_frame( sw_frame );
 
 	return true;
 }
@@ -463,19 +785,45 @@ bool FeVideoImp::hw_retrieve_data( AVFrame *f )
 
 void FeVideoImp::play()
 {
-	run_video_thread = true;
+	if ( playing )
+		return;
+
+	qscore = 10;
+	displayed = 0;
+	qscore_accum = 0;
+	late = 0;
+	skipped = 0;
+
+	degrading = false;
+	prev_pts = 0;
+	prev_duration = 0;
+	wait_time = sf::Time::Zero;
+
+	playing = true;
+	preloaded = false;
 	video_timer.restart();
-	m_video_thread.launch();
+
+	if ((!sws_ctx) || (!rgba_buffer[0][0]))
+	{
+		FeLog() << "Error initializing video decoding" << std::endl;
+		finish();
+		return;
+	}
+
+	FeVideoScheduler::get_ref().add( this );
 }
 
 void FeVideoImp::stop()
 {
-	if ( run_video_thread )
-	{
-		run_video_thread = false;
-		m_video_thread.wait();
-	}
+	//
+	// A worker may still be busy with us even if playing has been
+	// cleared (when we fell far behind), so always check with the
+	// scheduler
+	//
+	if ( FeVideoScheduler::get_ref().remove( this ) )
+		finish();
 
+	playing = false;
 	FeBaseStream::stop();
 }
 
@@ -501,13 +849,12 @@ namespace
 
 void FeVideoImp::preload()
 {
+	for ( int i=0; i<3; i++ )
 	{
-		sf::Lock l( image_swap_mutex );
-
-		if (rgba_buffer[0])
-			av_freep(&rgba_buffer[0]);
+		if (rgba_buffer[i][0])
+			av_freep(&rgba_buffer[i][0]);
 
-		int ret = av_image_alloc(rgba_buffer, rgba_linesize,
+		int ret = av_image_alloc(rgba_buffer[i], rgba_linesize,
 				disptex_width, disptex_height,
 				AV_PIX_FMT_RGBA, 1);
 		if (ret < 0)
@@ -535,11 +882,9 @@ void FeVideoImp::preload()
 			//
 			int got_frame = 0;
 #if (LIBAVCODEC_VERSION_INT >= AV_VERSION_INT( 55, 45, 0 ))
-			AVFrame *raw_frame = av_frame_alloc();
 			codec_ctx->refcounted_frames = 1;
-#else
-			AVFrame *raw_frame = avcodec_alloc_frame();
 #endif
+			AVFrame *raw_frame = alloc_frame();
 
 			int len = avcodec_decode_video2( codec_ctx, raw_frame,
 				&got_frame, packet );
@@ -570,221 +915,409 @@ void FeVideoImp::preload()
 				if ( !sws_ctx )
 				{
 					FeLog() << "Error allocating SwsContext during preload" << std::endl;
-					free_frame( raw_frame );
-					free_packet( packet );
+					release_frame( raw_frame );
+					release_packet( packet );
 					return;
 				}
 
-				sf::Lock l( image_swap_mutex );
+				sf::Uint8 **buff = rgba_buffer[ frames.back() ];
 				sws_scale( sws_ctx, raw_frame->data, raw_frame->linesize,
-							0, codec_ctx->height, rgba_buffer,
+							0, codec_ctx->height, buff,
 							rgba_linesize );
 
-				display_texture->update( rgba_buffer[0] );
+				display_texture->update( buff[0] );
+				preloaded = true;
 
 				keep_going = false;
 			}
 
-			free_frame( raw_frame );
-			free_packet( packet );
+			release_frame( raw_frame );
+			release_packet( packet );
 		}
 	}
 }
 
-void FeVideoImp::video_thread()
+bool FeVideoImp::decode_step( sf::Time &next )
 {
 	const int QMAX = 16;
 	const int QMIN = 0;
-	int qscore( 10 ); // quality scoring
-	int displayed( 0 ), qscore_accum( 0 );
-
-	AVFrame *detached_frame = NULL;
-	bool degrading = false;
 
-	int64_t prev_pts = 0;
-	int64_t prev_duration = 0;
+	next = sf::Time::Zero;
 
-	sf::Time wait_time;
-
-	if ((!sws_ctx) || (!rgba_buffer[0]))
+	//
+	// If we are falling behind for more than 2 seconds
+	// it can only mean that we are in suspend/hibernation state,
+	// so we flag the video to be restarted on the next tick.
+	// This prevents displaying only keyframes for several seconds on wake.
+	//
+	if ( wait_time < sf::seconds( -5.0f ) )
 	{
-		FeLog() << "Error initializing video thread" << std::endl;
-		goto the_end;
+		wait_time = sf::seconds( 0 );
+		far_behind = true;
+		playing = false;
+		return false;
 	}
 
-	while ( run_video_thread )
+	//
+	// First, display queued frame
+	//
+	if ( detached_frame )
 	{
-		bool do_process = true;
+		wait_time = (sf::Int64)detached_frame->pts * time_base
+				- m_parent->get_video_time();
 
-		//
-		// If we are falling behind for more than 2 seconds
-		// it can only mean that we are in suspend/hibernation state,
-		// so we flag the video to be restarted on the next tick.
-		// This prevents displaying only keyframes for several seconds on wake.
-		//
-		if ( wait_time < sf::seconds( -5.0f ) )
+		if ( wait_time < max_sleep )
 		{
-			wait_time = sf::seconds( 0 );
-			far_behind = true;
-			run_video_thread = false;
-		}
+			bool is_late = false;
 
-		//
-		// First, display queued frame
-		//
-		if ( detached_frame )
-		{
-			wait_time = (sf::Int64)detached_frame->pts * time_base
-					- m_parent->get_video_time();
+			if ( wait_time < -time_base )
+			{
+				is_late = true;
 
-			if ( wait_time < max_sleep )
+				// If we are falling behind, we may need to start discarding
+				// frames to catch up
+				//
+				if ( qscore > QMIN )
+					qscore--;
+
+				set_avdiscard_from_qscore( codec_ctx, qscore );
+				degrading = true;
+			}
+			else if ( wait_time >= sf::Time::Zero )
 			{
-				if ( wait_time < -time_base )
+				degrading = false;
 
+				//
+				// We are ahead, come back at presentation time
+				//
+				if ( wait_time > sf::milliseconds( 1 ) )
 				{
-					// If we are falling behind, we may need to start discarding
-					// frames to catch up
-					//
-					if ( qscore > QMIN )
-						qscore--;
-
-					set_avdiscard_from_qscore( codec_ctx, qscore );
-					degrading = true;
-				}
-				else if ( wait_time >= sf::Time::Zero )
-				{
-					//
-					// We are ahead and can sleep until presentation time
-					//
-					sf::sleep( wait_time );
-					degrading = false;
-
+					next = wait_time;
+					return true;
 				}
-
-				qscore_accum += qscore;
+			}
 
 #if FE_HWACCEL
-				hw_retrieve_data( detached_frame );
+			hw_retrieve_data( detached_frame );
 #endif
 
-				sf::Lock l( image_swap_mutex );
-				displayed++;
+			sws_scale( sws_ctx, detached_frame->data, detached_frame->linesize,
+						0, codec_ctx->height, rgba_buffer[ frames.back() ],
+						rgba_linesize );
 
-				sws_scale( sws_ctx, detached_frame->data, detached_frame->linesize,
-							0, codec_ctx->height, rgba_buffer,
-							rgba_linesize );
+			bool is_skipped = frames.publish();
 
-				display_frame = rgba_buffer[0];
+			displayed++;
+			qscore_accum += qscore;
 
-				free_frame( detached_frame );
-				detached_frame = NULL;
+			if ( is_late )
+				late++;
+			if ( is_skipped )
+				skipped++;
 
-				do_process = false;
-			}
-			//
-			// if we didn't do anything above, then we go into the queue
-			// management process below
-			//
+			release_frame( detached_frame );
+			detached_frame = NULL;
+			return true;
 		}
 
-		if ( do_process )
+		//
+		// full frame queue and nothing to display yet, so wait
+		//
+		if ( !degrading )
 		{
-			if ( !detached_frame )
-			{
-				//
-				// get next packet
-				//
-				AVPacket *packet = pop_packet();
-				if ( packet == NULL )
-				{
-					if ( !m_parent->end_of_file() )
-						m_parent->read_packet();
-					else
-						goto the_end;
-				}
-				else
-				{
-					//
-					// decompress packet and put it in our frame queue
-					//
-					int got_frame = 0;
+			if ( qscore < QMAX )
+				qscore++;
+
+			set_avdiscard_from_qscore( codec_ctx, qscore );
+		}
+
+		next = max_sleep;
+		return true;
+	}
+
+	//
+	// get next packet
+	//
+	AVPacket flush_packet;
+	bool draining = false;
+	AVPacket *packet = pop_packet();
+	if ( packet == NULL )
+	{
+		if ( !m_parent->end_of_file() )
+		{
+			m_parent->read_packet();
+			return true;
+		}
+
+		//
+		// At the end of the file, feed the decoder empty packets to get
+		// the frames it is still holding onto (a threaded decoder holds
+		// a frame per thread)
+		//
+		if ( codec_ctx->thread_count <= 1 )
+			return false;
+
+		av_init_packet( &flush_packet );
+		flush_packet.data = NULL;
+		flush_packet.size = 0;
+		packet = &flush_packet;
+		draining = true;
+	}
+
+	//
+	// decompress packet and put it in our frame queue
+	//
+	int got_frame = 0;
 #if (LIBAVCODEC_VERSION_INT >= AV_VERSION_INT( 55, 45, 0 ))
-					AVFrame *raw_frame = av_frame_alloc();
-					codec_ctx->refcounted_frames = 1;
-#else
-					AVFrame *raw_frame = avcodec_alloc_frame();
+	codec_ctx->refcounted_frames = 1;
 #endif
+	AVFrame *raw_frame = alloc_frame();
 
-					int len = avcodec_decode_video2( codec_ctx, raw_frame,
-							&got_frame, packet );
-					if ( len < 0 )
-						FeLog() << "Error decoding video" << std::endl;
+	int len = avcodec_decode_video2( codec_ctx, raw_frame,
+			&got_frame, packet );
+	if ( len < 0 )
+		FeLog() << "Error decoding video" << std::endl;
 
-					if ( got_frame )
-					{
-						raw_frame->pts = raw_frame->pkt_pts;
+	if ( got_frame )
+	{
+		raw_frame->pts = raw_frame->pkt_pts;
 
-						if ( raw_frame->pts == AV_NOPTS_VALUE )
-							raw_frame->pts = packet->dts;
+		if ( raw_frame->pts == AV_NOPTS_VALUE )
+			raw_frame->pts = packet->dts;
 
 // This only works on FFmpeg, exclude libav (it doesn't have pkt_duration
 #if (LIBAVUTIL_VERSION_MICRO >= 100 )
-						// Correct for out of bounds pts
-						if ( raw_frame->pts < prev_pts )
-							raw_frame->pts = prev_pts + prev_duration;
+		// Correct for out of bounds pts
+		if ( raw_frame->pts < prev_pts )
+			raw_frame->pts = prev_pts + prev_duration;
 
-						// Track pts and duration if we need to correct next frame
-						prev_pts = raw_frame->pts;
-						prev_duration = raw_frame->pkt_duration;
+		// Track pts and duration if we need to correct next frame
+		prev_pts = raw_frame->pts;
+		prev_duration = raw_frame->pkt_duration;
 #endif
 
-						detached_frame = raw_frame;
+		detached_frame = raw_frame;
+	}
+	else
+	{
+		release_frame( raw_frame );
 
-					}
-					else
-						free_frame( raw_frame );
+		if ( draining )
+			return false;
+	}
 
-					free_packet( packet );
-				}
-			}
-			else if ( !degrading )
+	if ( !draining )
+		release_packet( packet );
+
+	return true;
+}
+
+void FeVideoImp::finish()
+{
+	at_end=true;
+
+	frames.discard();
+
+	int average = ( displayed == 0 ) ? qscore_accum : ( qscore_accum / displayed );
+
+	if ( detached_frame )
+	{
+		release_frame( detached_frame );
+		detached_frame = NULL;
+	}
+
+	FeDebug() << "End Video - " << m_parent->m_imp->m_format_ctx->filename << std::endl
+				<< " - bit_rate=" << codec_ctx->bit_rate
+				<< ", width=" << codec_ctx->width << ", height=" << codec_ctx->height << std::endl
+				<< " - displayed=" << displayed
+				<< ", late=" << late << ", skipped=" << skipped << std::endl
+				<< " - average qscore=" << average
+				<< std::endl;
+}
+
+FeVideoScheduler &FeVideoScheduler::get_ref()
+{
+	static FeVideoScheduler scheduler;
+	return scheduler;
+}
+
+FeVideoScheduler::FeVideoScheduler()
+	: m_running( false )
+{
+}
+
+FeVideoScheduler::~FeVideoScheduler()
+{
+	{
+		sf::Lock l( m_mutex );
+		m_running = false;
+	}
+
+	for ( size_t i=0; i<m_threads.size(); i++ )
+		m_wake.post();
+
+	for ( std::vector< sf::Thread * >::iterator itr=m_threads.begin(); itr!=m_threads.end(); ++itr )
+	{
+		(*itr)->wait();
+		delete (*itr);
+	}
+}
+
+void FeVideoScheduler::start_threads()
+{
+	int count = std::max( 2, std::min( get_processor_count() - 1, 8 ) );
+
+	m_running = true;
+	for ( int i=0; i<count; i++ )
+	{
+		m_threads.push_back( new sf::Thread( &FeVideoScheduler::worker, this ) );
+		m_threads.back()->launch();
+	}
+
+	FeDebug() << "Started " << count << " video decoding thread(s)" << std::endl;
+}
+
+void FeVideoScheduler::add( FeVideoImp *v )
+{
+	sf::Lock l( m_mutex );
+
+	if ( !m_running )
+		start_threads();
+
+	Slot s;
+	s.video = v;
+	s.due = m_clock.getElapsedTime();
+	s.busy = false;
+	s.removing = false;
+	m_slots.push_back( s );
+
+	m_wake.post();
+}
+
+bool FeVideoScheduler::remove( FeVideoImp *v )
+{
+	for ( ;; )
+	{
+		{
+			sf::Lock l( m_mutex );
+
+			std::vector< Slot >::iterator itr;
+			for ( itr=m_slots.begin(); itr!=m_slots.end(); ++itr )
 			{
-				if ( qscore < QMAX )
-					qscore++;
+				if ( (*itr).video == v )
+					break;
+			}
 
-				set_avdiscard_from_qscore( codec_ctx, qscore );
+			if ( itr == m_slots.end() )
+				return false;
 
-				//
-				// full frame queue and nothing to display yet, so sleep
-				//
-				sf::sleep( max_sleep );
+			if ( !(*itr).busy )
+			{
+				m_slots.erase( itr );
+				return true;
 			}
+
+			// done_with() posts m_released when the worker is finished
+			(*itr).removing = true;
 		}
+
+		m_released.wait();
 	}
+}
+
+FeVideoImp *FeVideoScheduler::get_next( sf::Time &wait )
+{
+	sf::Lock l( m_mutex );
+
+	if ( !m_running )
+		return NULL;
 
-the_end:
 	//
-	// shutdown the thread
+	// find the video with the earliest deadline that isn't already being
+	// worked on or removed
 	//
-	at_end=true;
+	Slot *best = NULL;
+	for ( std::vector< Slot >::iterator itr=m_slots.begin(); itr!=m_slots.end(); ++itr )
+	{
+		if ( !(*itr).busy && !(*itr).removing
+				&& (( !best ) || ( (*itr).due < best->due )))
+			best = &(*itr);
+	}
 
+	if ( !best )
 	{
-		sf::Lock l( image_swap_mutex );
-		if (display_frame)
-			display_frame=NULL;
+		// nothing to do until a video gets added
+		wait = sf::Time::Zero;
+		return NULL;
 	}
 
-	if ( detached_frame )
-		free_frame( detached_frame );
+	sf::Time now = m_clock.getElapsedTime();
 
-	int average = ( displayed == 0 ) ? qscore_accum : ( qscore_accum / displayed );
+	if ( best->due <= now )
+	{
+		best->busy = true;
+		return best->video;
+	}
 
-	FeDebug() << "End Video Thread - " << m_parent->m_imp->m_format_ctx->filename << std::endl
-				<< " - bit_rate=" << codec_ctx->bit_rate
-				<< ", width=" << codec_ctx->width << ", height=" << codec_ctx->height << std::endl
-				<< " - displayed=" << displayed << std::endl
-				<< " - average qscore=" << average
-				<< std::endl;
+	// nothing is due yet, wait until something is
+	wait = best->due - now;
+	return NULL;
+}
+
+void FeVideoScheduler::done_with( FeVideoImp *v, bool keep, const sf::Time &next )
+{
+	sf::Lock l( m_mutex );
+
+	for ( std::vector< Slot >::iterator itr=m_slots.begin(); itr!=m_slots.end(); ++itr )
+	{
+		if ( (*itr).video == v )
+		{
+			bool removing = (*itr).removing;
+
+			if ( keep )
+			{
+				(*itr).due = m_clock.getElapsedTime() + next;
+				(*itr).busy = false;
+			}
+			else
+				m_slots.erase( itr );
+
+			if ( removing )
+				m_released.post();
+
+			return;
+		}
+	}
+}
+
+void FeVideoScheduler::worker( FeVideoScheduler *s )
+{
+	for ( ;; )
+	{
+		{
+			sf::Lock l( s->m_mutex );
+			if ( !s->m_running )
+				break;
+		}
+
+		sf::Time wait;
+		FeVideoImp *v = s->get_next( wait );
+
+		if ( v )
+		{
+			sf::Time next;
+			bool keep = v->decode_step( next );
+
+			if ( !keep )
+				v->finish();
+
+			s->done_with( v, keep, next );
+		}
+		else if ( wait == sf::Time::Zero )
+			s->m_wake.wait();
+		else
+			s->m_wake.wait( wait );
+	}
 }
 
 FeMedia::FeMedia( Type t )
@@ -887,7 +1420,7 @@ bool FeMedia::is_playing()
 		return false;
 
 	if ((m_video) && (!m_video->at_end))
-		return (m_video->run_video_thread);
+		return (m_video->playing);
 
 	return ((m_audio) && (sf::SoundStream::getStatus() == sf::SoundStream::Playing));
 }
@@ -1069,11 +1602,10 @@ bool FeMedia::open( const std::string &archive,
 			AVCodecContext *codec_ctx = m_imp->m_format_ctx->streams[stream_id]->codec;
 			codec_ctx->workaround_bugs = FF_BUG_AUTODETECT;
 
-			// Note also: http://trac.ffmpeg.org/ticket/4404
-			codec_ctx->thread_count=1;
-
 			try_hw_accel( codec_ctx, dec );
 
+			codec_ctx->thread_count = get_decode_thread_count( codec_ctx, dec );
+
 			if ( avcodec_open2( codec_ctx, dec, NULL ) < 0 )
 			{
 				FeLog() << "Could not open video decoder for file: "
@@ -1114,6 +1646,16 @@ bool FeMedia::open( const std::string &archive,
 	return true;
 }
 
+bool FeMedia::get_first_frame( const sf::Uint8 *&pixels, sf::Vector2u &size )
+{
+	if (( !m_video ) || ( !m_video->preloaded ))
+		return false;
+
+	pixels = m_video->rgba_buffer[ m_video->frames.back() ][0];
+	size = sf::Vector2u( m_video->disptex_width, m_video->disptex_height );
+	return true;
+}
+
 bool FeMedia::end_of_file()
 {
 	sf::Lock l(m_imp->m_read_mutex);
@@ -1129,22 +1671,32 @@ bool FeMedia::read_packet()
 	if ( m_imp->m_read_eof )
 		return false;
 
-	AVPacket *pkt = (AVPacket *)av_malloc( sizeof( *pkt ) );
+	//
+	// Packets are reused once the stream they were queued for is done
+	// with them, so we don't allocate a new one for every read
+	//
+	AVPacket *pkt = m_imp->m_read_packet;
+	if ( !pkt )
+		pkt = m_imp->m_read_packet = (AVPacket *)av_malloc( sizeof( *pkt ) );
 
 	int r = av_read_frame( m_imp->m_format_ctx, pkt );
 	if ( r < 0 )
 	{
 		m_imp->m_read_eof=true;
-		FeBaseStream::free_packet( pkt );
+		FeBaseStream::unref_packet( pkt );
 		return false;
 	}
 
+	FeBaseStream *s = NULL;
 	if ( ( m_audio ) && ( pkt->stream_index == m_audio->stream_id ) )
-		m_audio->push_packet( pkt );
+		s = m_audio;
 	else if ( ( m_video ) && (pkt->stream_index == m_video->stream_id ) )
-		m_video->push_packet( pkt );
+		s = m_video;
+
+	if (( s ) && ( s->push_packet( pkt ) ))
+		m_imp->m_read_packet = s->get_free_packet();
 	else
-		FeBaseStream::free_packet( pkt );
+		FeBaseStream::unref_packet( pkt );
 
 	return true;
 }
@@ -1154,15 +1706,11 @@ bool FeMedia::tick()
 	if (( !m_video ) && ( !m_audio ))
 		return false;
 
-	if ( m_video )
+	if (( m_video ) && ( m_video->frames.fetch() ))
 	{
-		sf::Lock l( m_video->image_swap_mutex );
-		if ( m_video->display_frame )
-		{
-			m_video->display_texture->update( m_video->display_frame );
-			m_video->display_frame = NULL;
-			return true;
-		}
+		m_video->display_texture->update(
+			m_video->rgba_buffer[ m_video->frames.front() ][0] );
+		return true;
 	}
 
 	return false;
@@ -1207,7 +1755,7 @@ bool FeMedia::onGetData( Chunk &data )
 						&bsize, packet) < 0 )
 			{
 				FeLog() << "Error decoding audio." << std::endl;
-				FeBaseStream::free_packet( packet );
+				m_audio->release_packet( packet );
 				return false;
 			}
 			else
@@ -1219,11 +1767,9 @@ bool FeMedia::onGetData( Chunk &data )
 		}
 #else
  #if (LIBAVCODEC_VERSION_INT >= AV_VERSION_INT( 55, 45, 0 ))
-		AVFrame *frame = av_frame_alloc();
 		m_audio->codec_ctx->refcounted_frames = 1;
- #else
-		AVFrame *frame = avcodec_alloc_frame();
  #endif
+		AVFrame *frame = m_audio->alloc_frame();
 		//
 		// TODO: avcodec_decode_audio4() can return multiple frames per packet depending on the codec.
 		// We don't deal with this appropriately...
@@ -1267,8 +1813,8 @@ bool FeMedia::onGetData( Chunk &data )
 					if ( !m_audio->resample_ctx )
 					{
 						FeLog() << "Error allocating audio format converter." << std::endl;
-						FeBaseStream::free_packet( packet );
-						FeBaseStream::free_frame( frame );
+						m_audio->release_packet( packet );
+						m_audio->release_frame( frame );
 						return false;
 					}
 
@@ -1297,8 +1843,8 @@ bool FeMedia::onGetData( Chunk &data )
 						FeLog() << "Error initializing audio format converter, input format="
 							<< av_get_sample_fmt_name( (AVSampleFormat)frame->format )
 							<< ", input sample rate=" << frame->sample_rate << std::endl;
-						FeBaseStream::free_packet( packet );
-						FeBaseStream::free_frame( frame );
+						m_audio->release_packet( packet );
+						m_audio->release_frame( frame );
 						resample_free( &m_audio->resample_ctx );
 						m_audio->resample_ctx = NULL;
 						return false;
@@ -1335,8 +1881,8 @@ bool FeMedia::onGetData( Chunk &data )
 					if ( out_samples < 0 )
 					{
 						FeLog() << "Error performing audio conversion." << std::endl;
-						FeBaseStream::free_packet( packet );
-						FeBaseStream::free_frame( frame );
+						m_audio->release_packet( packet );
+						m_audio->release_frame( frame );
 						break;
 					}
 					offset += out_samples * m_audio->codec_ctx->channels;
@@ -1346,11 +1892,11 @@ bool FeMedia::onGetData( Chunk &data )
 			}
 #endif
 		}
-		FeBaseStream::free_frame( frame );
+		m_audio->release_frame( frame );
 
 #endif
 
-		FeBaseStream::free_packet( packet );
+		m_audio->release_packet( packet );
 	}
 
 	return true;
@@ -1430,6 +1976,7 @@ const char *FeMedia::get_metadata( const char *tag )
 }
 
 std::string FeMedia::g_decoder;
+int FeMedia::g_decode_threads( 0 );
 
 #if FE_HWACCEL
 //
@@ -1495,6 +2042,50 @@ void FeMedia::set_current_decoder( const std::string &l )
 	g_decoder = l;
 }
 
+int FeMedia::get_decode_threads()
+{
+	return g_decode_threads;
+}
+
+void FeMedia::set_decode_threads( int t )
+{
+	g_decode_threads = ( t < 0 ) ? 0 : t;
+}
+
+int FeMedia::get_decode_thread_count( const AVCodecContext *codec_ctx, const AVCodec *dec )
+{
+	if ( g_decode_threads == 1 )
+		return 1;
+
+	//
+	// Hardware decoders are left single threaded.
+	// Note also: http://trac.ffmpeg.org/ticket/4404
+	//
+	if ( !g_decoder.empty() && ( g_decoder.compare( "software" ) != 0 ))
+		return 1;
+
+	if ( dec->id == AV_CODEC_ID_GIF )
+		return 1;
+
+	int max_threads = g_decode_threads;
+	if ( max_threads == 0 )
+		max_threads = std::min( get_processor_count(), 4 );
+
+	//
+	// Small videos (snaps etc.) get decoded single threaded, since
+	// threading adds latency and they keep up fine without it.  Large
+	// ones need the help to avoid falling back to keyframe-only decoding
+	//
+	int pixels = codec_ctx->width * codec_ctx->height;
+
+	if ( pixels >= 1920 * 1080 )
+		return max_threads;
+	else if ( pixels >= 1280 * 720 )
+		return std::min( max_threads, 2 );
+
+	return 1;
+}
+
 //
 // Try to use a hardware accelerated decoder where readily available...
 //
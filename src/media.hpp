@@ -24,6 +24,7 @@
 #define MEDIA_HPP
 
 #include <Audio/SoundStream.hpp>
+#include <SFML/System/Vector2.hpp>
 #include <vector>
 #include <string>
 
@@ -86,6 +87,14 @@ public:
 
 	const char *get_metadata( const char *tag );
 
+	//
+	// Get the first video frame (RGBA), as decoded by open().  The pixels
+	// are only valid until play() is called.
+	//
+	// returns false if there is no video or it couldn't be decoded
+	//
+	bool get_first_frame( const sf::Uint8 *&pixels, sf::Vector2u &size );
+
 	//
 	// return true if the given filename is a media file that can be opened
 	//	by FeMedia
@@ -100,6 +109,14 @@ public:
 	static std::string get_current_decoder();
 	static void set_current_decoder( const std::string & );
 
+	//
+	// get/set the maximum number of threads used to decode a video.  0 is
+	// automatic (based on the processor count), 1 disables threading.
+	// Only large videos are decoded with more than one thread.
+	//
+	static int get_decode_threads();
+	static void set_decode_threads( int );
+
 protected:
 	// overrides from base class
 	//
@@ -110,12 +127,14 @@ protected:
 	bool end_of_file();
 
 	void try_hw_accel( AVCodecContext *& ctx, AVCodec *&dec );
+	static int get_decode_thread_count( const AVCodecContext *ctx, const AVCodec *dec );
 
 private:
 	FeMediaImp *m_imp;
 	FeAudioImp *m_audio;
 	FeVideoImp *m_video;
 	static std::string g_decoder;
+	static int g_decode_threads;
 
 	FeMedia( const FeMedia & );
 	FeMedia &operator=( const FeMedia & );
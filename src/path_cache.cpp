@@ -21,25 +21,142 @@
  */
 
 #include "path_cache.hpp"
+#include "fe_info.hpp"
 
 #include "fe_base.hpp" // logging
 #include "fe_util.hpp"
 
+#include "nowide/fstream.hpp"
 #include <algorithm>
 #include <cstring>
+#include <cctype>
+#include <ctime>
 #include <dirent.h>
 #include <unistd.h>
 #include <fcntl.h>
 
 namespace
 {
+	//
+	// Increment FE_PC_VERSION whenever the file layout changes
+	//
+	const sf::Uint32 FE_PC_MAGIC = 0x43504d41; // "AMPC"
+	const sf::Uint32 FE_PC_VERSION = 1;
+	const sf::Uint32 FE_PC_END = 0xFFFFFFFF;
+
+	// FeArtworkCache starts over once it has this many entries
+	const size_t FE_AC_MAX_ENTRIES = 65536;
+
 	bool my_comp( const std::string &a, const std::string &b )
 	{
 		return ( strncasecmp( a.c_str(), b.c_str(), a.size() ) < 0 );
 	}
+
+	// case insensitive hash of the part of "s" before the first '.'
+	sf::Uint32 key_hash( const char *s, size_t len )
+	{
+		sf::Uint32 h = 2166136261u;
+		for ( size_t i=0; ( i < len ) && ( s[i] != '.' ); i++ )
+		{
+			h ^= (unsigned char)tolower( s[i] );
+			h *= 16777619u;
+		}
+		return h;
+	}
+
+	// returns -1 if the directory doesn't exist
+	sf::Int64 get_dir_mtime( const std::string &path )
+	{
+		// stat() on Windows fails if there is a trailing slash
+		std::string temp = path;
+		while (( temp.size() > 1 )
+				&& (( temp[ temp.size()-1 ] == '/' ) || ( temp[ temp.size()-1 ] == '\\' )))
+			temp.resize( temp.size()-1 );
+
+		sf::Int64 size( 0 ), mtime( -1 );
+		if ( !get_file_info( temp, size, mtime ) )
+			return -1;
+
+		return mtime;
+	}
+
+	void write_u32( nowide::ofstream &f, sf::Uint32 v )
+	{
+		f.write( (const char *)&v, sizeof( v ) );
+	}
+
+	void write_string( nowide::ofstream &f, const std::string &s )
+	{
+		write_u32( f, s.size() );
+		f.write( s.data(), s.size() );
+	}
+
+	class FeReader
+	{
+	public:
+		FeReader( const char *data, size_t size )
+			: m_pos( data ), m_end( data + size ), m_ok( true ) {};
+
+		bool ok() const { return m_ok; };
+
+		void read( void *dest, size_t len )
+		{
+			if (( !m_ok ) || ( (size_t)( m_end - m_pos ) < len ))
+			{
+				m_ok = false;
+				memset( dest, 0, len );
+				return;
+			}
+
+			memcpy( dest, m_pos, len );
+			m_pos += len;
+		}
+
+		void read_string( std::string &s )
+		{
+			sf::Uint32 len;
+			read( &len, sizeof( len ) );
+
+			if (( !m_ok ) || ( (size_t)( m_end - m_pos ) < len ))
+			{
+				m_ok = false;
+				return;
+			}
+
+			s.assign( m_pos, len );
+			m_pos += len;
+		}
+
+	private:
+		const char *m_pos;
+		const char *m_end;
+		bool m_ok;
+	};
 };
 
+void FePathCache::DirInfo::build_index()
+{
+	size_t size = 16;
+	while ( size < files.size() )
+		size *= 2;
+
+	heads.assign( size, FE_PC_END );
+	next.assign( files.size(), FE_PC_END );
+
+	// add in reverse so that each chain is in sorted order
+	for ( size_t i=files.size(); i > 0; i-- )
+	{
+		const std::string &f = files[i-1];
+		sf::Uint32 b = key_hash( f.c_str(), f.size() ) & ( size - 1 );
+
+		next[i-1] = heads[b];
+		heads[b] = i-1;
+	}
+}
+
 FePathCache::FePathCache()
+	: m_changed( false ),
+	m_generation( 0 )
 {
 }
 
@@ -50,9 +167,111 @@ FePathCache::~FePathCache()
 void FePathCache::clear()
 {
 	m_cache.clear();
+	m_changed = true;
+	m_generation++;
 	FeDebug() << "Cleared artwork path cache." << std::endl;
 }
 
+void FePathCache::revalidate()
+{
+	m_generation++;
+
+	for ( std::map< std::string, DirInfo >::iterator itr=m_cache.begin();
+			itr!=m_cache.end(); ++itr )
+		(*itr).second.checked = false;
+}
+
+bool FePathCache::load( const std::string &filename )
+{
+	m_cache.clear();
+	m_changed = false;
+	m_generation++;
+
+	FeFileMapping map;
+	if ( !map.open( filename ) )
+		return false;
+
+	FeReader r( map.data(), map.size() );
+
+	sf::Uint32 magic, version, count;
+	r.read( &magic, sizeof( magic ) );
+	r.read( &version, sizeof( version ) );
+	r.read( &count, sizeof( count ) );
+
+	if (( magic != FE_PC_MAGIC ) || ( version != FE_PC_VERSION ))
+		return false;
+
+	for ( sf::Uint32 i=0; ( i < count ) && r.ok(); i++ )
+	{
+		std::string path;
+		r.read_string( path );
+
+		DirInfo &info = m_cache[ path ];
+		info.checked = false;
+		r.read( &info.mtime, sizeof( info.mtime ) );
+
+		sf::Uint32 file_count;
+		r.read( &file_count, sizeof( file_count ) );
+
+		for ( sf::Uint32 j=0; ( j < file_count ) && r.ok(); j++ )
+		{
+			info.files.push_back( std::string() );
+			r.read_string( info.files.back() );
+		}
+
+		info.build_index();
+	}
+
+	if ( !r.ok() )
+	{
+		FeLog() << "Error reading artwork path cache: " << filename << std::endl;
+		m_cache.clear();
+		return false;
+	}
+
+	FeDebug() << "Loaded artwork path cache: " << filename << " ("
+		<< m_cache.size() << " paths)." << std::endl;
+
+	return true;
+}
+
+bool FePathCache::save( const std::string &filename )
+{
+	if ( !m_changed )
+		return true;
+
+	nowide::ofstream outfile( filename.c_str(),
+		std::ios_base::out | std::ios_base::binary );
+
+	if ( !outfile.is_open() )
+	{
+		FeLog() << "Error writing artwork path cache: " << filename << std::endl;
+		return false;
+	}
+
+	write_u32( outfile, FE_PC_MAGIC );
+	write_u32( outfile, FE_PC_VERSION );
+	write_u32( outfile, m_cache.size() );
+
+	for ( std::map< std::string, DirInfo >::iterator itr=m_cache.begin();
+			itr!=m_cache.end(); ++itr )
+	{
+		const DirInfo &info = (*itr).second;
+
+		write_string( outfile, (*itr).first );
+		outfile.write( (const char *)&info.mtime, sizeof( info.mtime ) );
+		write_u32( outfile, info.files.size() );
+
+		for ( std::vector<std::string>::const_iterator itf=info.files.begin();
+				itf!=info.files.end(); ++itf )
+			write_string( outfile, *itf );
+	}
+
+	outfile.close();
+	m_changed = false;
+	return true;
+}
+
 // from fe_util
 bool FePathCache::get_filename_from_base(
 	std::vector<std::string> &in_list,
@@ -61,7 +280,31 @@ bool FePathCache::get_filename_from_base(
 	const std::string &base_name,
 	const char **filter )
 {
-	std::vector<std::string> &cache = get_cache( path );
+	DirInfo &info = get_cache( path );
+	const std::vector<std::string> &cache = info.files;
+
+	if ( base_name.find( '.' ) != std::string::npos )
+	{
+		//
+		// Use the hash index.  Any file that starts with "base_name" has
+		// the same name up to the first '.'
+		//
+		sf::Uint32 b = key_hash( base_name.c_str(), base_name.size() )
+			& ( info.heads.size() - 1 );
+
+		for ( sf::Uint32 i=info.heads[b]; i != FE_PC_END; i=info.next[i] )
+		{
+			if ( strncasecmp( cache[i].c_str(), base_name.c_str(), base_name.size() ) != 0 )
+				continue;
+
+			if ( filter && !(tail_compare( cache[i], filter )) )
+				out_list.push_back( path + cache[i] );
+			else
+				in_list.push_back( path + cache[i] );
+		}
+
+		return !(in_list.empty());
+	}
 
 	std::vector< std::string >::const_iterator itr;
 	itr = std::lower_bound( cache.begin(), cache.end(), base_name, my_comp );
@@ -83,19 +326,53 @@ bool FePathCache::get_filename_from_base(
 	return !(in_list.empty());
 }
 
-std::vector < std::string > &FePathCache::get_cache( const std::string &path )
+FePathCache::DirInfo &FePathCache::get_cache( const std::string &path )
 {
-	std::map< std::string, std::vector<std::string> >::iterator itr;
+	std::map< std::string, DirInfo >::iterator itr;
 
 	itr = m_cache.find( path );
 	if ( itr != m_cache.end() )
-		return (*itr).second;
+	{
+		DirInfo &info = (*itr).second;
+		if ( info.checked )
+			return info;
+
+		//
+		// Make sure the directory hasn't changed since we cached it
+		//
+		if ( get_dir_mtime( path ) != info.mtime )
+		{
+			scan_dir( path, info );
+			m_generation++;
+		}
+
+		info.checked = true;
+		return info;
+	}
+
+	DirInfo &info = m_cache[ path ];
+	scan_dir( path, info );
+	info.checked = true;
+	return info;
+}
 
+void FePathCache::scan_dir( const std::string &path, DirInfo &info )
+{
 	DIR *dir;
 	struct dirent *ent;
 
 	std::vector < std::string > temp;
 
+	info.mtime = get_dir_mtime( path );
+
+	//
+	// The modification time only has a resolution of seconds, so a directory
+	// that changed very recently could change again without us noticing.
+	// Make sure those get scanned again the next time they are checked
+	//
+	if ( info.mtime >= (sf::Int64)time( NULL ) - 1 )
+		info.mtime = -2;
+
 	if ( (dir = opendir( path.c_str() )) == NULL )
 	{
 		FeDebug() << "dir_cache: Error opening directory: " << path << std::endl;
@@ -122,13 +399,156 @@ std::vector < std::string > &FePathCache::get_cache( const std::string &path )
 
 	FeDebug() << "Caching contents of artwork path: " << path << " (" << temp.size() << " entries)." << std::endl;
 
-	std::pair<std::map<std::string, std::vector<std::string> >::iterator, bool> ret;
+	info.files.swap( temp );
+	info.build_index();
+	m_changed = true;
+}
+
+FeArtworkCache::FeArtworkCache()
+	: m_path_generation( 0 ),
+	m_display( -1 ),
+	m_state( -1 )
+{
+}
+
+void FeArtworkCache::clear()
+{
+	m_entries.clear();
+	m_heads.clear();
+}
+
+void FeArtworkCache::validate( sf::Uint32 path_generation, int display, int state )
+{
+	if (( path_generation == m_path_generation )
+			&& ( display == m_display )
+			&& ( state == m_state ))
+		return;
+
+	clear();
+	m_path_generation = path_generation;
+	m_display = display;
+	m_state = state;
+}
+
+void FeArtworkCache::get_key( const FeRomInfo &rom, sf::Uint32 *key )
+{
+	const FeRomInfo::Index idx[KEY_COUNT] = {
+		FeRomInfo::Romname,
+		FeRomInfo::AltRomname,
+		FeRomInfo::Cloneof,
+		FeRomInfo::Emulator };
+
+	// the serial identifies the value, ids get reused once a value is gone
+	for ( int i=0; i<KEY_COUNT; i++ )
+		key[i] = FeRomInfo::get_column_serial( idx[i], rom.get_info_id( idx[i] ) );
+}
+
+sf::Uint32 FeArtworkCache::get_hash( const sf::Uint32 *key,
+	const std::string &art_name,
+	int flags )
+{
+	sf::Uint32 h = 2166136261u;
+	for ( int i=0; i<KEY_COUNT; i++ )
+	{
+		h ^= key[i];
+		h *= 16777619u;
+	}
+
+	for ( std::string::const_iterator itr=art_name.begin(); itr!=art_name.end(); ++itr )
+	{
+		h ^= (unsigned char)(*itr);
+		h *= 16777619u;
+	}
+
+	h ^= flags;
+	h *= 16777619u;
+	return h;
+}
+
+const FeArtworkCache::Entry *FeArtworkCache::find_entry( const sf::Uint32 *key,
+	const std::string &art_name,
+	int flags,
+	sf::Uint32 h ) const
+{
+	if ( m_heads.empty() )
+		return NULL;
+
+	for ( sf::Uint32 i=m_heads[ h & ( m_heads.size() - 1 ) ]; i != FE_PC_END; i=m_entries[i].next )
+	{
+		const Entry &e = m_entries[i];
+		if (( e.flags == flags )
+				&& ( memcmp( e.key, key, sizeof( e.key ) ) == 0 )
+				&& ( e.art_name.compare( art_name ) == 0 ))
+			return &e;
+	}
+
+	return NULL;
+}
+
+bool FeArtworkCache::find( const FeRomInfo &rom,
+	const std::string &art_name,
+	int flags,
+	std::vector<std::string> &vids,
+	std::vector<std::string> &images,
+	bool &result ) const
+{
+	sf::Uint32 key[KEY_COUNT];
+	get_key( rom, key );
+
+	const Entry *e = find_entry( key, art_name, flags, get_hash( key, art_name, flags ) );
+	if ( !e )
+		return false;
+
+	vids.insert( vids.end(), e->vids.begin(), e->vids.end() );
+	images.insert( images.end(), e->images.begin(), e->images.end() );
+	result = e->result;
+	return true;
+}
 
-	ret = m_cache.insert(
-		std::pair< std::string, std::vector<std::string> >( path, std::vector<std::string>() ) );
+void FeArtworkCache::insert( const FeRomInfo &rom,
+	const std::string &art_name,
+	int flags,
+	const std::vector<std::string> &vids,
+	const std::vector<std::string> &images,
+	bool result )
+{
+	sf::Uint32 key[KEY_COUNT];
+	get_key( rom, key );
+	sf::Uint32 h = get_hash( key, art_name, flags );
+
+	if ( find_entry( key, art_name, flags, h ) )
+		return;
+
+	if ( m_entries.size() >= FE_AC_MAX_ENTRIES )
+		clear();
+
+	//
+	// Grow the table so chains stay short, rehashing what is there
+	//
+	if ( m_entries.size() >= m_heads.size() )
+	{
+		size_t size = m_heads.empty() ? 256 : m_heads.size() * 2;
+		m_heads.assign( size, FE_PC_END );
+
+		for ( sf::Uint32 i=0; i<m_entries.size(); i++ )
+		{
+			Entry &e = m_entries[i];
+			sf::Uint32 b = get_hash( e.key, e.art_name, e.flags ) & ( size - 1 );
+			e.next = m_heads[b];
+			m_heads[b] = i;
+		}
+	}
 
-	if ( ret.second )
-		ret.first->second.swap( temp );
+	m_entries.push_back( Entry() );
+	Entry &e = m_entries.back();
+	memcpy( e.key, key, sizeof( e.key ) );
+	e.art_name = art_name;
+	e.flags = flags;
+	e.result = result;
+	e.vids = vids;
+	e.images = images;
 
-	return ret.first->second;
+	sf::Uint32 b = h & ( m_heads.size() - 1 );
+	e.next = m_heads[b];
+	m_heads[b] = m_entries.size() - 1;
 }
@@ -26,7 +26,16 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <deque>
+#include <SFML/Config.hpp>
 
+class FeRomInfo;
+
+//
+// Cache of artwork directory contents.  The cache can be saved to and
+// loaded from disk, each directory is revalidated against its
+// modification time before its cached contents are used.
+//
 class FePathCache
 {
 public:
@@ -35,6 +44,15 @@ public:
 
 	void clear();
 
+	// check each directory's modification time again before next use
+	void revalidate();
+
+	bool load( const std::string &filename );
+	bool save( const std::string &filename );
+
+	// changes whenever previously cached directory contents might have changed
+	sf::Uint32 get_generation() const { return m_generation; };
+
 	bool get_filename_from_base(
 		std::vector<std::string> &in_list,
 		std::vector<std::string> &out_list,
@@ -43,12 +61,93 @@ public:
 		const char **filter );
 
 private:
-	std::map< std::string, std::vector<std::string> > m_cache;
+	struct DirInfo
+	{
+		DirInfo() : mtime( -1 ), checked( false ) {};
+
+		std::vector<std::string> files; // sorted (case insensitive)
+		sf::Int64 mtime;
+		bool checked; // true if mtime has been checked since last revalidate()
+
+		// hash index of files by the (case insensitive) part of their
+		// name before the first '.'
+		std::vector<sf::Uint32> heads;
+		std::vector<sf::Uint32> next;
+
+		void build_index();
+	};
+
+	std::map< std::string, DirInfo > m_cache;
+	bool m_changed; // true if m_cache has changed since it was saved/loaded
+	sf::Uint32 m_generation;
 
 	FePathCache( FePathCache & );
 	FePathCache &operator=( FePathCache & );
 
-	std::vector < std::string > &get_cache( const std::string &path );
+	DirInfo &get_cache( const std::string &path );
+	void scan_dir( const std::string &path, DirInfo &info );
+};
+
+//
+// Memo of artwork lookup results (see FeSettings::get_best_artwork_file()),
+// keyed on the rom's romname, altname, cloneof and emulator values, the
+// artwork label and the lookup flags.  The results depend on the artwork
+// directory contents and the current display and presentation state, so
+// everything is dropped whenever one of those might have changed.
+//
+class FeArtworkCache
+{
+public:
+	FeArtworkCache();
+
+	void clear();
+
+	// drop all results if they were found with a different path cache
+	// generation, display or presentation state
+	void validate( sf::Uint32 path_generation, int display, int state );
+
+	//
+	// Find the memoized result for the given lookup.  If found, the
+	// artwork is appended to "vids" and "images", "result" gets the
+	// lookup's return value and this returns true.
+	//
+	bool find( const FeRomInfo &rom,
+		const std::string &art_name,
+		int flags,
+		std::vector<std::string> &vids,
+		std::vector<std::string> &images,
+		bool &result ) const;
+
+	void insert( const FeRomInfo &rom,
+		const std::string &art_name,
+		int flags,
+		const std::vector<std::string> &vids,
+		const std::vector<std::string> &images,
+		bool result );
+
+private:
+	enum { KEY_COUNT=4 };
+
+	struct Entry
+	{
+		sf::Uint32 key[KEY_COUNT]; // serials of the rom's interned values
+		std::string art_name;
+		int flags;
+		bool result;
+		std::vector<std::string> vids;
+		std::vector<std::string> images;
+		sf::Uint32 next; // next entry in the hash chain
+	};
+
+	std::deque<Entry> m_entries; // a deque so growing doesn't copy the entries
+	std::vector<sf::Uint32> m_heads;
+	sf::Uint32 m_path_generation;
+	int m_display;
+	int m_state;
+
+	static void get_key( const FeRomInfo &rom, sf::Uint32 *key );
+	static sf::Uint32 get_hash( const sf::Uint32 *key, const std::string &art_name, int flags );
+	const Entry *find_entry( const sf::Uint32 *key, const std::string &art_name, int flags, sf::Uint32 h ) const;
 };
 
 #endif
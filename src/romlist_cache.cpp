@@ -0,0 +1,215 @@
+/*
+ *
+ *  Attract-Mode frontend
+ *  Copyright (C) 2020 Andrew Mickelson
+ *
+ *  This file is part of Attract-Mode.
+ *
+ *  Attract-Mode is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Attract-Mode is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Attract-Mode.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "romlist_cache.hpp"
+#include "fe_base.hpp" // logging
+
+#include "nowide/fstream.hpp"
+#include <cstring>
+
+const char *FE_ROMLIST_CACHE_EXTENSION = ".idx";
+
+namespace
+{
+	//
+	// Increment FE_RLC_VERSION whenever the cache layout changes
+	//
+	const sf::Uint32 FE_RLC_MAGIC = 0x434c4d41; // "AMLC"
+	const sf::Uint32 FE_RLC_VERSION = 1;
+
+	struct FeRomListCacheHeader
+	{
+		sf::Uint32 magic;
+		sf::Uint32 version;
+		sf::Uint32 field_count;
+		sf::Uint32 entry_count;
+		sf::Uint32 strings_size;
+		sf::Uint32 reserved;
+		sf::Int64 source_size;
+		sf::Int64 source_mtime;
+	};
+};
+
+FeRomListCache::FeRomListCache()
+	: m_offsets( NULL ),
+	m_strings( NULL ),
+	m_strings_size( 0 ),
+	m_entry_count( 0 ),
+	m_building( false )
+{
+}
+
+FeRomListCache::~FeRomListCache()
+{
+	close();
+}
+
+bool FeRomListCache::open( const std::string &romlist_file,
+	const std::string &cache_file )
+{
+	close();
+
+	sf::Int64 src_size, src_mtime;
+	if ( !get_file_info( romlist_file, src_size, src_mtime ) )
+		return false;
+
+	if ( !m_map.open( cache_file ) )
+		return false;
+
+	if ( m_map.size() < sizeof( FeRomListCacheHeader ) )
+	{
+		close();
+		return false;
+	}
+
+	FeRomListCacheHeader h;
+	memcpy( &h, m_map.data(), sizeof( FeRomListCacheHeader ) );
+
+	size_t expected = sizeof( FeRomListCacheHeader )
+		+ (size_t)h.entry_count * h.field_count * sizeof( sf::Uint32 )
+		+ h.strings_size;
+
+	if (( h.magic != FE_RLC_MAGIC )
+		|| ( h.version != FE_RLC_VERSION )
+		|| ( h.field_count != (sf::Uint32)FeRomInfo::Favourite )
+		|| ( h.source_size != src_size )
+		|| ( h.source_mtime != src_mtime )
+		|| ( h.strings_size < 1 )
+		|| ( expected != m_map.size() ))
+	{
+		FeDebug() << "Romlist cache is out of date: " << cache_file << std::endl;
+		close();
+		return false;
+	}
+
+	m_offsets = (const sf::Uint32 *)( m_map.data() + sizeof( FeRomListCacheHeader ) );
+	m_strings = (const char *)( m_offsets + (size_t)h.entry_count * h.field_count );
+	m_strings_size = h.strings_size;
+	m_entry_count = h.entry_count;
+
+	// every string in the table is null terminated, so this guarantees
+	// that lookups can't run off the end of the mapping
+	if ( m_strings[ m_strings_size - 1 ] != 0 )
+	{
+		close();
+		return false;
+	}
+
+	return true;
+}
+
+void FeRomListCache::close()
+{
+	m_map.close();
+	m_offsets = NULL;
+	m_strings = NULL;
+	m_strings_size = 0;
+	m_entry_count = 0;
+
+	m_building = false;
+	m_build_index.clear();
+	m_build_offsets.clear();
+	m_build_strings.clear();
+}
+
+void FeRomListCache::get_entry( int idx, FeRomInfo &rom ) const
+{
+	ASSERT(( idx >= 0 ) && ( idx < m_entry_count ));
+	const sf::Uint32 *o = m_offsets + (size_t)idx * FeRomInfo::Favourite;
+
+	for ( int i=0; i < FeRomInfo::Favourite; i++ )
+	{
+		if ( o[i] < m_strings_size )
+			rom.set_info( (FeRomInfo::Index)i, m_strings + o[i] );
+	}
+}
+
+void FeRomListCache::begin_build()
+{
+	close();
+	m_building = true;
+
+	// offset 0 is always the empty string
+	intern( "" );
+}
+
+sf::Uint32 FeRomListCache::intern( const std::string &s )
+{
+	std::map<std::string, sf::Uint32>::iterator itr = m_build_index.find( s );
+	if ( itr != m_build_index.end() )
+		return (*itr).second;
+
+	sf::Uint32 retval = m_build_strings.size();
+	m_build_strings.append( s.c_str(), s.size() + 1 );
+	m_build_index.insert( itr, std::pair<std::string, sf::Uint32>( s, retval ) );
+
+	return retval;
+}
+
+void FeRomListCache::add_entry( const FeRomInfo &rom )
+{
+	for ( int i=0; i < FeRomInfo::Favourite; i++ )
+		m_build_offsets.push_back( intern( rom.get_info( i ) ) );
+}
+
+bool FeRomListCache::save( const std::string &romlist_file,
+	const std::string &cache_file )
+{
+	FeRomListCacheHeader h;
+	memset( &h, 0, sizeof( FeRomListCacheHeader ) );
+
+	bool retval = get_file_info( romlist_file, h.source_size, h.source_mtime );
+
+	if ( retval )
+	{
+		h.magic = FE_RLC_MAGIC;
+		h.version = FE_RLC_VERSION;
+		h.field_count = FeRomInfo::Favourite;
+		h.entry_count = m_build_offsets.size() / FeRomInfo::Favourite;
+		h.strings_size = m_build_strings.size();
+
+		nowide::ofstream outfile( cache_file.c_str(), std::ios_base::binary );
+		if ( outfile.is_open() )
+		{
+			outfile.write( (const char *)&h, sizeof( FeRomListCacheHeader ) );
+
+			if ( !m_build_offsets.empty() )
+				outfile.write( (const char *)&(m_build_offsets[0]),
+					m_build_offsets.size() * sizeof( sf::Uint32 ) );
+
+			outfile.write( m_build_strings.data(), m_build_strings.size() );
+			retval = outfile.good();
+			outfile.close();
+		}
+		else
+			retval = false;
+	}
+
+	if ( !retval )
+	{
+		FeDebug() << "Unable to write romlist cache: " << cache_file << std::endl;
+		delete_file( cache_file );
+	}
+
+	close();
+	return retval;
+}
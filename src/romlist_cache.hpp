@@ -0,0 +1,91 @@
+/*
+ *
+ *  Attract-Mode frontend
+ *  Copyright (C) 2020 Andrew Mickelson
+ *
+ *  This file is part of Attract-Mode.
+ *
+ *  Attract-Mode is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Attract-Mode is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Attract-Mode.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ROMLIST_CACHE_HPP
+#define ROMLIST_CACHE_HPP
+
+#include "fe_info.hpp"
+#include "fe_util.hpp"
+
+#include <string>
+#include <vector>
+#include <map>
+
+extern const char *FE_ROMLIST_CACHE_EXTENSION;
+
+//
+// Binary sidecar for a romlist file.  The cache stores a deduplicated
+// string table along with the string offsets for each field of each
+// romlist entry, and is keyed to the size and modification time of the
+// romlist file that it was built from.
+//
+class FeRomListCache
+{
+public:
+	FeRomListCache();
+	~FeRomListCache();
+
+	//
+	// Map the cache file for reading.  Returns false if the cache is
+	// missing, corrupt or out of date with respect to "romlist_file"
+	//
+	bool open( const std::string &romlist_file,
+		const std::string &cache_file );
+	void close();
+
+	int size() const { return m_entry_count; };
+
+	// fill the romlist fields (everything before Favourite) of "rom"
+	// from cache entry "idx"
+	void get_entry( int idx, FeRomInfo &rom ) const;
+
+	//
+	// Functions for building a new cache
+	//
+	void begin_build();
+	void add_entry( const FeRomInfo &rom );
+	bool is_building() const { return m_building; };
+
+	// write out the cache built since begin_build().  Returns false on
+	// error
+	bool save( const std::string &romlist_file,
+		const std::string &cache_file );
+
+private:
+	FeRomListCache( const FeRomListCache & );
+	FeRomListCache &operator=( const FeRomListCache & );
+
+	sf::Uint32 intern( const std::string &s );
+
+	FeFileMapping m_map;
+	const sf::Uint32 *m_offsets;
+	const char *m_strings;
+	sf::Uint32 m_strings_size;
+	int m_entry_count;
+
+	bool m_building;
+	std::map<std::string, sf::Uint32> m_build_index;
+	std::vector<sf::Uint32> m_build_offsets;
+	std::string m_build_strings;
+};
+
+#endif
@@ -130,7 +130,7 @@ std::string get_crc( const std::string &full_path,
 				char *buff = zs.getData();
 				int size = zs.getSize();
 
-				if ( size > MAX_CRC_FILE_SIZE )
+				if (( !buff ) || ( size > MAX_CRC_FILE_SIZE ))
 					return "";
 
 				correct_buff_for_format( buff, size, *itr );
@@ -682,6 +682,9 @@ bool FeSettings::thegamesdb_scraper( FeImporterContext &c )
 {
 	FeLog() << " - scraping thegamesdb.net..." << std::endl;
 
+	// pick up any artwork downloaded by earlier scrapers
+	m_path_cache.revalidate();
+
 	int remaining_allowance = -1;
 
 	std::string path = get_config_dir();
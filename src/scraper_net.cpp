@@ -123,6 +123,9 @@ bool FeSettings::simple_scraper( FeImporterContext &c,
 
 	bool is_snap = ( strcmp( art_label, "snap" ) == 0 );
 
+	// pick up any artwork downloaded by earlier scrapers
+	m_path_cache.revalidate();
+
 	for ( FeRomInfoListType::iterator itr=c.romlist.begin(); itr!=c.romlist.end(); ++itr )
 	{
 		// ugh, this must be set for has_artwork() to correctly function
@@ -0,0 +1,258 @@
+/*
+ *
+ *  Attract-Mode frontend
+ *  Copyright (C) 2020 Andrew Mickelson
+ *
+ *  This file is part of Attract-Mode.
+ *
+ *  Attract-Mode is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Attract-Mode is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Attract-Mode.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "script_cache.hpp"
+#include "fe_base.hpp" // logging
+#include "fe_util.hpp"
+#include "zip.hpp"
+#include "nowide/cstdio.hpp"
+#include "nowide/fstream.hpp"
+
+#include <sqstdio.h>
+#include <SFML/System/Clock.hpp>
+#include <cstring>
+#include <sstream>
+
+const char *FE_SCRIPT_CACHE_EXTENSION = ".cnut";
+
+namespace
+{
+	//
+	// Cache file layout:
+	//
+	// "FESC" tag, format version, Squirrel version, length of the key
+	// header (bytes), key header, compile time (microseconds) and then the
+	// closure as written by sq_writeclosure()
+	//
+	const char SC_TAG[] = "FESC";
+	const sf::Uint32 SC_FORMAT_VERSION = 1;
+
+	void append_bytes( std::string &buff, const void *data, size_t len )
+	{
+		buff.append( (const char *)data, len );
+	}
+
+	SQInteger write_to_string( SQUserPointer up, SQUserPointer data, SQInteger size )
+	{
+		((std::string *)up)->append( (const char *)data, size );
+		return size;
+	}
+
+	struct ReadState
+	{
+		const char *pos;
+		const char *end;
+	};
+
+	SQInteger read_from_buffer( SQUserPointer up, SQUserPointer data, SQInteger size )
+	{
+		ReadState *s = (ReadState *)up;
+		if ( size > s->end - s->pos )
+			return -1;
+
+		memcpy( data, s->pos, size );
+		s->pos += size;
+		return size;
+	}
+};
+
+FeScriptCache &FeScriptCache::get_ref()
+{
+	static FeScriptCache cache;
+	return cache;
+}
+
+FeScriptCache::FeScriptCache()
+	: m_hits( 0 )
+{
+}
+
+void FeScriptCache::set_path( const std::string &path )
+{
+	m_path = path;
+}
+
+void FeScriptCache::take_stats( int &hits, sf::Time &saved )
+{
+	hits = m_hits;
+	saved = m_saved;
+
+	m_hits = 0;
+	m_saved = sf::Time::Zero;
+}
+
+SQRESULT FeScriptCache::load( HSQUIRRELVM vm,
+	const std::string &path,
+	const std::string &filename,
+	const std::string &source )
+{
+	bool in_archive = is_supported_archive( path );
+
+	//
+	// The key header identifies the script and the version of it that was
+	// compiled.  It is stored in the cache file and has to match exactly
+	//
+	std::string key = in_archive ? path + "|" + filename : path + filename;
+	std::string cache_file;
+	std::string header;
+	sf::Int64 size, mtime;
+
+	if (( !m_path.empty() )
+			&& get_file_info( in_archive ? path : key, size, mtime ))
+	{
+		sf::Uint32 sq_version = SQUIRREL_VERSION_NUMBER;
+		append_bytes( header, &sq_version, sizeof( sq_version ) );
+		append_bytes( header, &size, sizeof( size ) );
+		append_bytes( header, &mtime, sizeof( mtime ) );
+		header += key;
+
+		// FNV-1a hash of the key
+		sf::Uint32 hash = 2166136261u;
+		for ( std::string::const_iterator itr=key.begin(); itr!=key.end(); ++itr )
+		{
+			hash ^= (unsigned char)(*itr);
+			hash *= 16777619u;
+		}
+
+		std::ostringstream ss;
+		ss << m_path << std::hex << hash << FE_SCRIPT_CACHE_EXTENSION;
+		cache_file = ss.str();
+
+		if ( read_cached( vm, cache_file, header ) )
+			return SQ_OK;
+	}
+
+	sf::Clock compile_timer;
+	SQRESULT res;
+
+	if ( in_archive )
+		res = sq_compilebuffer( vm, source.c_str(), source.size(), _SC(""), true );
+	else
+		res = sqstd_loadfile( vm, key.c_str(), true );
+
+	if ( SQ_SUCCEEDED( res ) && !cache_file.empty() )
+		write_cached( vm, cache_file, header, compile_timer.getElapsedTime() );
+
+	return res;
+}
+
+bool FeScriptCache::read_cached( HSQUIRRELVM vm,
+	const std::string &cache_file,
+	const std::string &header )
+{
+	nowide::ifstream f( cache_file.c_str(), std::ios_base::binary );
+	if ( !f.is_open() )
+		return false;
+
+	std::string buff;
+	f.seekg( 0, std::ios_base::end );
+	buff.resize( (size_t)f.tellg() );
+	f.seekg( 0, std::ios_base::beg );
+
+	if ( !buff.empty() )
+		f.read( &buff[0], buff.size() );
+
+	if ( !f )
+		return false;
+
+	ReadState s;
+	s.pos = buff.data();
+	s.end = buff.data() + buff.size();
+
+	char tag[4];
+	sf::Uint32 version, header_len, compile_us;
+
+	if (( read_from_buffer( &s, tag, 4 ) != 4 )
+			|| ( memcmp( tag, SC_TAG, 4 ) != 0 )
+			|| ( read_from_buffer( &s, &version, sizeof( version ) ) != sizeof( version ) )
+			|| ( version != SC_FORMAT_VERSION )
+			|| ( read_from_buffer( &s, &header_len, sizeof( header_len ) ) != sizeof( header_len ) )
+			|| ( header_len != header.size() )
+			|| ( s.end - s.pos < (SQInteger)header_len )
+			|| ( header.compare( 0, header_len, s.pos, header_len ) != 0 ))
+		return false; // stale or not ours
+
+	s.pos += header_len;
+
+	if ( read_from_buffer( &s, &compile_us, sizeof( compile_us ) ) != sizeof( compile_us ) )
+		return false;
+
+	if ( SQ_FAILED( sq_readclosure( vm, read_from_buffer, &s ) ) )
+	{
+		FeDebug() << "Error reading compiled script: " << cache_file << std::endl;
+		sq_reseterror( vm );
+		return false;
+	}
+
+	m_hits++;
+	m_saved += sf::microseconds( compile_us );
+	return true;
+}
+
+void FeScriptCache::write_cached( HSQUIRRELVM vm,
+	const std::string &cache_file,
+	const std::string &header,
+	const sf::Time &compile_time )
+{
+	std::string buff;
+	sf::Uint32 version = SC_FORMAT_VERSION;
+	sf::Uint32 header_len = header.size();
+	sf::Uint32 compile_us = compile_time.asMicroseconds();
+
+	buff.append( SC_TAG, 4 );
+	append_bytes( buff, &version, sizeof( version ) );
+	append_bytes( buff, &header_len, sizeof( header_len ) );
+	buff += header;
+	append_bytes( buff, &compile_us, sizeof( compile_us ) );
+
+	if ( SQ_FAILED( sq_writeclosure( vm, write_to_string, &buff ) ) )
+	{
+		// some closures can't be written, these just don't get cached
+		sq_reseterror( vm );
+		return;
+	}
+
+	//
+	// Write to a temporary file first, so that a partly written cache
+	// file is never read
+	//
+	size_t pos = cache_file.find_last_of( '/' ) + 1;
+	std::string tmp_name = cache_file.substr( 0, pos ) + "~" + cache_file.substr( pos );
+
+	{
+		nowide::ofstream f( tmp_name.c_str(), std::ios_base::binary );
+		if ( !f.is_open() )
+			return;
+
+		f.write( buff.data(), buff.size() );
+		if ( !f )
+		{
+			f.close();
+			delete_file( tmp_name );
+			return;
+		}
+	}
+
+	delete_file( cache_file );
+	if ( nowide::rename( tmp_name.c_str(), cache_file.c_str() ) != 0 )
+		delete_file( tmp_name );
+}
@@ -0,0 +1,87 @@
+/*
+ *
+ *  Attract-Mode frontend
+ *  Copyright (C) 2020 Andrew Mickelson
+ *
+ *  This file is part of Attract-Mode.
+ *
+ *  Attract-Mode is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Attract-Mode is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Attract-Mode.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef SCRIPT_CACHE_HPP
+#define SCRIPT_CACHE_HPP
+
+#include <squirrel.h>
+#include <SFML/System/Time.hpp>
+#include <string>
+
+extern const char *FE_SCRIPT_CACHE_EXTENSION;
+
+//
+// Persistent cache of compiled Squirrel scripts (layouts, modules and
+// plugins).  The closure produced by compiling a script is saved using
+// Squirrel's closure writer, and is loaded instead of compiling the script
+// the next time it is run.
+//
+// Each script gets one cache file, keyed on the script's path and name,
+// size and modification time along with the Squirrel version.  Scripts in
+// archives are keyed on the archive.
+//
+class FeScriptCache
+{
+public:
+	static FeScriptCache &get_ref();
+
+	// directory to keep compiled scripts in.  Nothing is cached until this is set
+	void set_path( const std::string &path );
+
+	//
+	// Compile script "filename" in "path" (an archive or a directory to
+	// prepend to filename) and push the resulting closure onto the stack
+	// of "vm".  "source" is the script's text if it was read from an
+	// archive, and is unused otherwise.
+	//
+	// returns SQ_ERROR if the script could not be compiled, with the error
+	// set on "vm"
+	//
+	SQRESULT load( HSQUIRRELVM vm,
+		const std::string &path,
+		const std::string &filename,
+		const std::string &source );
+
+	// get and reset the number of scripts loaded from the cache and the
+	// compile time that they saved
+	void take_stats( int &hits, sf::Time &saved );
+
+private:
+	FeScriptCache();
+	FeScriptCache( const FeScriptCache & );
+	FeScriptCache &operator=( const FeScriptCache & );
+
+	std::string m_path;
+	int m_hits;
+	sf::Time m_saved;
+
+	bool read_cached( HSQUIRRELVM vm,
+		const std::string &cache_file,
+		const std::string &header );
+
+	void write_cached( HSQUIRRELVM vm,
+		const std::string &cache_file,
+		const std::string &header,
+		const sf::Time &compile_time );
+};
+
+#endif
@@ -0,0 +1,243 @@
+/*
+ *
+ *  Attract-Mode frontend
+ *  Copyright (C) 2020 Andrew Mickelson
+ *
+ *  This file is part of Attract-Mode.
+ *
+ *  Attract-Mode is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Attract-Mode is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Attract-Mode.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "search_index.hpp"
+#include "fe_base.hpp" // logging
+
+#include <SFML/System/Clock.hpp>
+#include <algorithm>
+#include <cstring>
+
+const FeRomInfo::Index FeSearchIndex::indexed[] =
+{
+	FeRomInfo::Title,
+	FeRomInfo::AltTitle,
+	FeRomInfo::Manufacturer
+};
+
+namespace
+{
+	inline sf::Uint32 get_trigram( const std::string &s, size_t pos )
+	{
+		return ( (sf::Uint32)(unsigned char)s[pos] << 16 )
+			| ( (sf::Uint32)(unsigned char)s[pos+1] << 8 )
+			| (sf::Uint32)(unsigned char)s[pos+2];
+	}
+
+	class TrigramLess
+	{
+	public:
+		bool operator()( const std::pair< sf::Uint32, sf::Uint32 > &a, sf::Uint32 b ) const
+			{ return a.first < b; };
+		bool operator()( sf::Uint32 a, const std::pair< sf::Uint32, sf::Uint32 > &b ) const
+			{ return a < b.first; };
+	};
+};
+
+FeSearchIndex::FeSearchIndex()
+	: m_last_column( -1 )
+{
+}
+
+bool FeSearchIndex::is_indexed( FeRomInfo::Index c )
+{
+	for ( int i=0; i<INDEXED_COUNT; i++ )
+	{
+		if ( indexed[i] == c )
+			return true;
+	}
+
+	return false;
+}
+
+void FeSearchIndex::fold_case( const std::string &in, std::string &out )
+{
+	out.resize( in.size() );
+	for ( size_t i=0; i<in.size(); i++ )
+	{
+		char c = in[i];
+		out[i] = (( c >= 'A' ) && ( c <= 'Z' )) ? c - 'A' + 'a' : c;
+	}
+}
+
+bool FeSearchIndex::get_search_text( const FeRule &rule, std::string &text )
+{
+	if (( rule.get_comp() != FeRule::FilterContains )
+			|| ( !is_indexed( rule.get_target() ) ))
+		return false;
+
+	//
+	// Plain text is used as is.  We also accept the "[Xx]" brackets that
+	// the KeyboardSearch plugin uses to match either case of a letter.
+	// Anything else is left to the regular expression engine.
+	//
+	const std::string &what = rule.get_what();
+	text.clear();
+
+	for ( size_t i=0; i<what.size(); i++ )
+	{
+		char c = what[i];
+		if ( c == '[' )
+		{
+			if (( i + 3 >= what.size() ) || ( what[i+3] != ']' ))
+				return false;
+
+			std::string a, b;
+			fold_case( what.substr( i+1, 1 ), a );
+			fold_case( what.substr( i+2, 1 ), b );
+
+			if ( a.compare( b ) != 0 )
+				return false;
+
+			text += a;
+			i += 3;
+		}
+		else if ( strchr( "\\^$.|?*+()]{}", c ) )
+			return false;
+		else
+			text += (( c >= 'A' ) && ( c <= 'Z' )) ? c - 'A' + 'a' : c;
+	}
+
+	return !text.empty();
+}
+
+void FeSearchIndex::build( Column &col, FeRomInfo::Index c )
+{
+	sf::Clock timer;
+	sf::Uint32 size = FeRomInfo::get_column_size( c );
+
+	col.folded.resize( size );
+	col.trigrams.clear();
+
+	for ( sf::Uint32 id=1; id<size; id++ )
+	{
+		std::string &f = col.folded[id];
+		fold_case( FeRomInfo::get_column_value( c, id ), f );
+
+		for ( size_t pos=0; pos+2<f.size(); pos++ )
+			col.trigrams.push_back(
+				std::pair< sf::Uint32, sf::Uint32 >( get_trigram( f, pos ), id ) );
+	}
+
+	std::sort( col.trigrams.begin(), col.trigrams.end() );
+	col.trigrams.erase(
+		std::unique( col.trigrams.begin(), col.trigrams.end() ),
+		col.trigrams.end() );
+
+	col.generation = FeRomInfo::get_column_generation( c );
+	col.built = true;
+
+	FeDebug() << "Built search index for " << FeRomInfo::indexStrings[c]
+		<< " (" << size << " values) in "
+		<< timer.getElapsedTime().asMilliseconds() << " ms" << std::endl;
+}
+
+bool FeSearchIndex::find( FeRomInfo::Index c,
+	const std::string &text,
+	std::vector< sf::Uint32 > &matches )
+{
+	int ci=0;
+	while (( ci < INDEXED_COUNT ) && ( indexed[ci] != c ))
+		ci++;
+
+	if ( ci >= INDEXED_COUNT )
+		return false;
+
+	Column &col = m_columns[ci];
+	matches.clear();
+
+	if (( !col.built )
+			|| ( col.generation != FeRomInfo::get_column_generation( c ) ))
+	{
+		build( col, c );
+		m_last_column = -1;
+	}
+
+	if (( m_last_column == ci )
+			&& ( text.compare( 0, m_last_text.size(), m_last_text ) == 0 ))
+	{
+		//
+		// The text has been extended since the last search, so only the
+		// last search's matches can still match
+		//
+		for ( std::vector< sf::Uint32 >::iterator itr=m_last_matches.begin();
+				itr!=m_last_matches.end(); ++itr )
+		{
+			if ( col.folded[ *itr ].find( text ) != std::string::npos )
+				matches.push_back( *itr );
+		}
+	}
+	else if ( text.size() < 3 )
+	{
+		// too short for the trigrams, so check every value
+		for ( sf::Uint32 id=1; id<col.folded.size(); id++ )
+		{
+			if ( col.folded[id].find( text ) != std::string::npos )
+				matches.push_back( id );
+		}
+	}
+	else
+	{
+		//
+		// Check the values containing the least common of the text's
+		// trigrams
+		//
+		std::pair< std::vector< std::pair< sf::Uint32, sf::Uint32 > >::iterator,
+			std::vector< std::pair< sf::Uint32, sf::Uint32 > >::iterator > best;
+
+		for ( size_t pos=0; pos+2<text.size(); pos++ )
+		{
+			std::pair< std::vector< std::pair< sf::Uint32, sf::Uint32 > >::iterator,
+				std::vector< std::pair< sf::Uint32, sf::Uint32 > >::iterator > r
+				= std::equal_range( col.trigrams.begin(), col.trigrams.end(),
+					get_trigram( text, pos ), TrigramLess() );
+
+			if (( pos == 0 ) || ( r.second - r.first < best.second - best.first ))
+				best = r;
+
+			if ( best.first == best.second )
+				break;
+		}
+
+		for ( ; best.first != best.second; ++best.first )
+		{
+			sf::Uint32 id = (*best.first).second;
+			if ( col.folded[id].find( text ) != std::string::npos )
+				matches.push_back( id );
+		}
+	}
+
+	m_last_column = ci;
+	m_last_text = text;
+	m_last_matches = matches;
+	return true;
+}
+
+void FeSearchIndex::clear()
+{
+	for ( int i=0; i<INDEXED_COUNT; i++ )
+		m_columns[i] = Column();
+
+	m_last_column = -1;
+	m_last_text.clear();
+	m_last_matches.clear();
+}
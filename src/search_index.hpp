@@ -0,0 +1,96 @@
+/*
+ *
+ *  Attract-Mode frontend
+ *  Copyright (C) 2020 Andrew Mickelson
+ *
+ *  This file is part of Attract-Mode.
+ *
+ *  Attract-Mode is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Attract-Mode is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Attract-Mode.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef SEARCH_INDEX_HPP
+#define SEARCH_INDEX_HPP
+
+#include "fe_info.hpp"
+
+#include <string>
+#include <vector>
+
+//
+// Trigram index of the Title, AltTitle and Manufacturer values, used for
+// case insensitive "contains" searches.  The index covers the distinct
+// (interned) values of each attribute rather than the romlist entries, so
+// it is shared by all of the filters.  Each attribute's index is built the
+// first time it is searched and rebuilt once new values have been added to
+// the attribute (see FeRomInfo::get_column_generation()).
+//
+// Text is folded to lower case (ASCII only) for both indexing and searching.
+//
+class FeSearchIndex
+{
+public:
+	FeSearchIndex();
+
+	static bool is_indexed( FeRomInfo::Index c );
+
+	// Get the text that every value matched by "rule" has to contain
+	// (folded to lower case).  Returns false if the rule can't be narrowed
+	// down using the index.
+	static bool get_search_text( const FeRule &rule, std::string &text );
+
+	static void fold_case( const std::string &in, std::string &out );
+
+	//
+	// Put the ids of the values of attribute "c" that contain "text" in
+	// "matches" (in increasing order).  "text" has to already be folded.
+	//
+	// Searching for text that extends the previous search (i.e. when
+	// another letter is typed) only checks the previous search's matches.
+	//
+	// Returns false if "c" isn't indexed
+	//
+	bool find( FeRomInfo::Index c,
+		const std::string &text,
+		std::vector< sf::Uint32 > &matches );
+
+	void clear();
+
+private:
+	struct Column
+	{
+		Column() : generation( 0 ), built( false ) {};
+
+		sf::Uint32 generation;
+		bool built;
+		std::vector< std::string > folded; // folded values, by value id
+
+		// (trigram, value id) pairs, sorted
+		std::vector< std::pair< sf::Uint32, sf::Uint32 > > trigrams;
+	};
+
+	enum { INDEXED_COUNT=3 };
+	static const FeRomInfo::Index indexed[INDEXED_COUNT];
+
+	Column m_columns[INDEXED_COUNT];
+
+	// the last search, for narrowing the next one
+	int m_last_column;
+	std::string m_last_text;
+	std::vector< sf::Uint32 > m_last_matches;
+
+	void build( Column &col, FeRomInfo::Index c );
+};
+
+#endif
@@ -0,0 +1,238 @@
+/*
+ *
+ *  Attract-Mode frontend
+ *  Copyright (C) 2020 Andrew Mickelson
+ *
+ *  This file is part of Attract-Mode.
+ *
+ *  Attract-Mode is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Attract-Mode is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Attract-Mode.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "stats_store.hpp"
+#include "fe_info.hpp"
+#include "fe_util.hpp"
+#include "fe_base.hpp" // logging
+
+#include "nowide/fstream.hpp"
+#include <vector>
+
+const char *FE_STATS_FILE_EXTENSION = ".stats";
+
+FeStatsStore::FeStatsStore()
+	: m_record_count( 0 )
+{
+}
+
+FeStatsStore::~FeStatsStore()
+{
+	close();
+}
+
+bool FeStatsStore::open( const std::string &path,
+	const std::string &romlist_name )
+{
+	close();
+
+	std::string filename = path + romlist_name + FE_STATS_FILE_EXTENSION;
+	nowide::ifstream myfile( filename.c_str() );
+
+	if ( !myfile.is_open() )
+	{
+		//
+		// No stats file yet, import the stats from the old "one file per
+		// game" layout if there are any
+		//
+		m_filename = filename;
+		load_legacy( path + romlist_name + "/" );
+
+		if ( !m_entries.empty() )
+		{
+			FeLog() << " - Imported stats for " << m_entries.size()
+				<< " games to: " << m_filename << std::endl;
+
+			return write_all();
+		}
+
+		return true;
+	}
+
+	while ( myfile.good() )
+	{
+		std::string line, romname, count;
+		getline( myfile, line );
+
+		size_t pos=0;
+		token_helper( line, pos, romname );
+		if ( romname.empty() )
+			continue;
+
+		m_record_count++;
+
+		//
+		// A record with no values means that the stats for that game
+		// were removed
+		//
+		if ( pos >= line.size() )
+		{
+			m_entries.erase( romname );
+			continue;
+		}
+
+		token_helper( line, pos, count );
+
+		Entry &e = m_entries[ romname ];
+		e.count = as_int( count );
+		e.time = as_int( line.substr( pos ) );
+	}
+
+	myfile.close();
+	m_filename = filename;
+
+	// compact the file if most of its records are obsolete
+	if ( m_record_count > 2 * (int)m_entries.size() + 64 )
+		return write_all();
+
+	return true;
+}
+
+void FeStatsStore::close()
+{
+	flush();
+
+	m_filename.clear();
+	m_entries.clear();
+	m_pending.clear();
+	m_record_count = 0;
+}
+
+bool FeStatsStore::get( const std::string &romname,
+	int &count, int &time ) const
+{
+	std::map<std::string, Entry>::const_iterator itr = m_entries.find( romname );
+	if ( itr == m_entries.end() )
+		return false;
+
+	count = (*itr).second.count;
+	time = (*itr).second.time;
+	return true;
+}
+
+void FeStatsStore::set( const std::string &romname, int count, int time )
+{
+	Entry &e = m_entries[ romname ];
+	e.count = count;
+	e.time = time;
+
+	add_record( romname, &e );
+}
+
+void FeStatsStore::erase( const std::string &romname )
+{
+	if ( m_entries.erase( romname ) )
+		add_record( romname, NULL );
+}
+
+bool FeStatsStore::flush()
+{
+	if ( m_pending.empty() || m_filename.empty() )
+		return true;
+
+	nowide::ofstream myfile( m_filename.c_str(),
+		std::ios_base::out | std::ios_base::app );
+
+	if ( !myfile.is_open() )
+	{
+		FeLog() << "Error writing stats file: " << m_filename << std::endl;
+		return false;
+	}
+
+	myfile << m_pending;
+	myfile.close();
+
+	m_pending.clear();
+	return true;
+}
+
+void FeStatsStore::load_legacy( const std::string &path )
+{
+	std::vector<std::string> list;
+	get_basename_from_extension( list, path, FE_STAT_FILE_EXTENSION );
+
+	for ( std::vector<std::string>::iterator itr=list.begin();
+			itr != list.end(); ++itr )
+	{
+		std::string filename = path + (*itr) + FE_STAT_FILE_EXTENSION;
+		nowide::ifstream myfile( filename.c_str() );
+
+		if ( !myfile.is_open() )
+			continue;
+
+		std::string count, time;
+		getline( myfile, count );
+		getline( myfile, time );
+		myfile.close();
+
+		Entry &e = m_entries[ (*itr) ];
+		e.count = as_int( count );
+		e.time = as_int( time );
+	}
+}
+
+bool FeStatsStore::write_all()
+{
+	m_pending.clear();
+	m_record_count = 0;
+
+	for ( std::map<std::string, Entry>::iterator itr=m_entries.begin();
+			itr != m_entries.end(); ++itr )
+		add_record( (*itr).first, &( (*itr).second ) );
+
+	nowide::ofstream myfile( m_filename.c_str() );
+
+	if ( !myfile.is_open() )
+	{
+		FeLog() << "Error writing stats file: " << m_filename << std::endl;
+		return false;
+	}
+
+	myfile << m_pending;
+	myfile.close();
+
+	m_pending.clear();
+	return true;
+}
+
+void FeStatsStore::add_record( const std::string &romname, const Entry *e )
+{
+	if ( romname.find_first_of( ';' ) != std::string::npos )
+	{
+		std::string temp = romname;
+		perform_substitution( temp, "\"", "\\\"" );
+		m_pending += "\"" + temp + "\"";
+	}
+	else
+		m_pending += romname;
+
+	if ( e )
+	{
+		m_pending += ';';
+		m_pending += as_str( e->count );
+		m_pending += ';';
+		m_pending += as_str( e->time );
+	}
+
+	m_pending += '\n';
+	m_record_count++;
+}
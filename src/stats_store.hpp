@@ -0,0 +1,80 @@
+/*
+ *
+ *  Attract-Mode frontend
+ *  Copyright (C) 2020 Andrew Mickelson
+ *
+ *  This file is part of Attract-Mode.
+ *
+ *  Attract-Mode is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Attract-Mode is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Attract-Mode.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef STATS_STORE_HPP
+#define STATS_STORE_HPP
+
+#include <string>
+#include <map>
+
+extern const char *FE_STATS_FILE_EXTENSION;
+
+//
+// Play statistics for all of the games in a romlist, kept in a single
+// file in the stats directory (i.e. "stats/<romlist>.stats").
+//
+// The file is an append-only log of "romname;played_count;played_time"
+// records where the last record for a game wins, and is compacted when
+// opened if it has grown too much.  The legacy layout of one ".stat" file
+// per game in "stats/<romlist>/" is imported the first time a romlist's
+// stats are opened.
+//
+class FeStatsStore
+{
+public:
+	FeStatsStore();
+	~FeStatsStore();
+
+	// "path" is the stats directory.  Returns false on error
+	bool open( const std::string &path, const std::string &romlist_name );
+	void close();
+	bool is_open() const { return !m_filename.empty(); };
+
+	// returns false if there are no stats for "romname"
+	bool get( const std::string &romname, int &count, int &time ) const;
+	void set( const std::string &romname, int count, int time );
+	void erase( const std::string &romname );
+
+	// write any changes made since the last flush to disk
+	bool flush();
+
+private:
+	FeStatsStore( const FeStatsStore & );
+	FeStatsStore &operator=( const FeStatsStore & );
+
+	struct Entry
+	{
+		int count;
+		int time;
+	};
+
+	void load_legacy( const std::string &path );
+	bool write_all();
+	void add_record( const std::string &romname, const Entry *e );
+
+	std::string m_filename;
+	std::map<std::string, Entry> m_entries;
+	std::string m_pending; // records not written yet
+	int m_record_count; // number of records in the file
+};
+
+#endif
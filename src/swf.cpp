@@ -54,9 +54,11 @@ namespace
 
 	static tu_file *swf_file_opener( const char *url )
 	{
-		if ( swf_zip )
+		char *data = swf_zip ? swf_zip->getData() : NULL;
+
+		if ( data )
 			return new tu_file( tu_file::memory_buffer,
-				swf_zip->getSize(), swf_zip->getData() );
+				swf_zip->getSize(), data );
 		else
 			return new tu_file(url, "rb");
 	}
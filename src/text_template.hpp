@@ -0,0 +1,84 @@
+/*
+ *
+ *  Attract-Mode frontend
+ *  Copyright (C) 2020 Andrew Mickelson
+ *
+ *  This file is part of Attract-Mode.
+ *
+ *  Attract-Mode is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Attract-Mode is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Attract-Mode.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef TEXT_TEMPLATE_HPP
+#define TEXT_TEMPLATE_HPP
+
+#include <string>
+#include <vector>
+
+class FeSettings;
+
+//
+// A text substitution string (i.e. "[Title] ([Year])") parsed into a list
+// of literal text and field operations, so that it can be evaluated by
+// FeSettings::do_text_substitutions() repeatedly without being rescanned.
+//
+// This is kept out of fe_settings.hpp so that the presentables can hold
+// one without pulling in all of the settings.  It is implemented in
+// fe_settings.cpp along with the substitutions themselves.
+//
+class FeTextTemplate
+{
+public:
+	FeTextTemplate();
+	FeTextTemplate( const std::string &format );
+
+	void compile( const std::string &format );
+
+	const std::string &get_format() const { return m_format; };
+
+	//
+	// A magic token ("[!function_name]") in the format string.  "slot" and
+	// "serial" are filled in by the script to remember which function the
+	// token was last resolved to (see FeVM::get_magic_fn())
+	//
+	struct Magic
+	{
+		std::string name;
+		size_t pos;
+		size_t len;
+		mutable int slot;
+		mutable int serial;
+	};
+
+	// true if the string contains magic tokens, which have to be processed
+	// by the script before the substitutions are made
+	bool has_magic() const { return !m_magic.empty(); };
+	const std::vector<Magic> &get_magic() const { return m_magic; };
+
+private:
+	friend class FeSettings;
+
+	struct Op
+	{
+		int token; // -1 for literal text
+		size_t pos;
+		size_t len;
+	};
+
+	std::string m_format;
+	std::vector<Op> m_ops;
+	std::vector<Magic> m_magic;
+};
+
+#endif
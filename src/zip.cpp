@@ -23,8 +23,12 @@
 #include "zip.hpp"
 #include "fe_util.hpp"
 #include "fe_base.hpp"
+#include "nowide/cstdio.hpp"
 #include <iostream>
 #include <cstring>
+#include <algorithm>
+#include <list>
+#include <map>
 #include <SFML/System/Mutex.hpp>
 #include <SFML/System/Lock.hpp>
 
@@ -141,6 +145,7 @@ namespace
 
 #include "archive.h"
 #include "archive_entry.h"
+#include <zlib.h>
 
 namespace
 {
@@ -157,158 +162,496 @@ namespace
 
 		return a;
 	}
-};
-
-bool fe_zip_open_to_buff(
-	const char *arch,
-	const char *filename,
-	std::vector< char > &buff )
-{
-	struct archive *a = my_archive_init();
-	int r = archive_read_open_filename( a, arch, 8192 );
 
-	if ( r != ARCHIVE_OK )
+	bool archive_open_to_buff(
+		const char *arch,
+		const char *filename,
+		std::vector< char > &buff )
 	{
-		FeLog() << "Error opening archive: "
-			<< arch << std::endl;
+		struct archive *a = my_archive_init();
+		int r = archive_read_open_filename( a, arch, 8192 );
+
+		if ( r != ARCHIVE_OK )
+		{
+			FeLog() << "Error opening archive: "
+				<< arch << std::endl;
+			archive_read_free( a );
+			return false;
+		}
+
+		struct archive_entry *ae;
+
+		std::string fn = filename;
+		while ( archive_read_next_header( a, &ae ) == ARCHIVE_OK )
+		{
+			if ( fn.compare( archive_entry_pathname( ae ) ) == 0 )
+			{
+				size_t total = archive_entry_size( ae );
+
+				buff.resize( total );
+				archive_read_data( a, &(buff[0]), buff.size() );
+				archive_read_free( a );
+				return true;
+			}
+		}
+
 		archive_read_free( a );
 		return false;
 	}
 
-	struct archive_entry *ae;
-
-	std::string fn = filename;
-	while ( archive_read_next_header( a, &ae ) == ARCHIVE_OK )
+	bool archive_get_dir(
+		const char *archive,
+		std::vector<std::string> &result )
 	{
-		if ( fn.compare( archive_entry_pathname( ae ) ) == 0 )
-		{
-			size_t total = archive_entry_size( ae );
+		struct archive *a = my_archive_init();
+		int r = archive_read_open_filename( a, archive, 8192 );
 
-			buff.resize( total );
-			archive_read_data( a, &(buff[0]), buff.size() );
+		if ( r != ARCHIVE_OK )
+		{
+			FeLog() << "Error opening archive: "
+				<< archive << std::endl;
 			archive_read_free( a );
-			return true;
+			return false;
 		}
+
+		struct archive_entry *ae;
+
+		while ( archive_read_next_header( a, &ae ) == ARCHIVE_OK )
+			result.push_back( archive_entry_pathname( ae ) );
+
+		archive_read_free( a );
+		return true;
 	}
+};
 
-	archive_read_free( a );
-	return false;
-}
+#else
 
-bool fe_zip_get_dir(
-	const char *archive,
-	std::vector<std::string> &result )
+#include "miniz.c"
+
+namespace
 {
-	sf::Lock l( g_ccache_mutex );
-	if ( check_content_cache( archive, result ) )
-		return true;
+	bool archive_open_to_buff(
+		const char *archive,
+		const char *filename,
+		std::vector< char > &buff )
+	{
+		mz_zip_archive zip;
+		memset( &zip, 0, sizeof( zip ) );
+
+		if ( !mz_zip_reader_init_file( &zip, archive, 0 ) )
+		{
+			FeLog() << "Error initializing zip.  zip: "
+				<< archive << std::endl;
+			return false;
+		}
 
-	struct archive *a = my_archive_init();
-	int r = archive_read_open_filename( a, archive, 8192 );
+		int index = mz_zip_reader_locate_file( &zip,
+			filename, NULL, 0 );
+		if ( index < 0 )
+		{
+			mz_zip_reader_end( &zip );
+			return false;
+		}
+
+		mz_zip_archive_file_stat file_stat;
+		if ( !mz_zip_reader_file_stat(&zip, index, &file_stat) )
+		{
+			FeLog() << "Error reading filestats. zip: "
+				<< archive << ", file: " << filename << std::endl;
+			mz_zip_reader_end( &zip );
+			return false;
+		}
+
+		buff.resize( file_stat.m_uncomp_size );
+
+		if ( !mz_zip_reader_extract_to_mem( &zip,
+			index, &(buff[0]), buff.size(), 0 ) )
+		{
+			FeLog() << "Error extracting to buffer. zip: "
+				<< archive << ", file: " << filename << std::endl;
+			mz_zip_reader_end( &zip );
+			return false;
+		}
+
+		mz_zip_reader_end( &zip );
+		return true;
+	}
 
-	if ( r != ARCHIVE_OK )
+	bool archive_get_dir(
+		const char *archive,
+		std::vector<std::string> &result )
 	{
-		FeLog() << "Error opening archive: "
-			<< archive << std::endl;
-		archive_read_free( a );
-		return false;
+		mz_zip_archive zip;
+		memset( &zip, 0, sizeof( zip ) );
+
+		if ( !mz_zip_reader_init_file( &zip, archive, 0 ) )
+		{
+			FeLog() << "Error initializing zip: "
+				<< archive << std::endl;
+			return false;
+		}
+
+		for ( int i=0; i<(int)mz_zip_reader_get_num_files(&zip); i++)
+		{
+			mz_zip_archive_file_stat file_stat;
+			if ( mz_zip_reader_file_stat(&zip, i, &file_stat) )
+				result.push_back( file_stat.m_filename );
+		}
+
+		mz_zip_reader_end( &zip );
+		return true;
 	}
+};
 
-	struct archive_entry *ae;
+#endif // USE_LIBARCHIVE
 
-	while ( archive_read_next_header( a, &ae ) == ARCHIVE_OK )
-		result.push_back( archive_entry_pathname( ae ) );
+namespace
+{
+	//
+	// Zip files are read directly using an index of their central
+	// directory, which is cached for INDEX_CACHE_SIZE archives and checked
+	// against the archive's size and modification time before use.
+	//
+	// Other archive types (and zip features we don't handle) fall back to
+	// archive_open_to_buff() and archive_get_dir()
+	//
+	const int INDEX_CACHE_SIZE = 8;
+	const size_t ZIP_EOCD_SIZE = 22;
+	const size_t ZIP_CD_HEADER_SIZE = 46;
+	const size_t ZIP_LOCAL_HEADER_SIZE = 30;
 
-	archive_read_free( a );
+	// deflated entries up to this size get inflated into memory the first
+	// time they are seeked backwards in, see FeZipStream::read()
+	const sf::Int64 ZIP_INFLATE_BUFFER_LIMIT = 64 * 1024 * 1024;
 
-	add_to_content_cache( archive, result );
-	return true;
-}
+	struct FeZipIndex
+	{
+		sf::Int64 file_size;
+		sf::Int64 mtime;
+		std::vector< FeZipEntry > entries;
+		std::map< std::string, size_t > names;
+	};
 
-#else
+	std::list< std::pair< std::string, FeZipIndex > > g_icache;
+	sf::Mutex g_icache_mutex;
 
-#include "miniz.c"
+	sf::Uint16 get_u16( const unsigned char *p )
+	{
+		return p[0] | ( p[1] << 8 );
+	}
 
-bool fe_zip_open_to_buff(
-	const char *archive,
-	const char *filename,
-	std::vector< char > &buff )
-{
-	mz_zip_archive zip;
-	memset( &zip, 0, sizeof( zip ) );
+	sf::Uint32 get_u32( const unsigned char *p )
+	{
+		return p[0] | ( p[1] << 8 ) | ( p[2] << 16 ) | ( (sf::Uint32)p[3] << 24 );
+	}
 
-	if ( !mz_zip_reader_init_file( &zip, archive, 0 ) )
+	sf::Uint64 get_u64( const unsigned char *p )
 	{
-		FeLog() << "Error initializing zip.  zip: "
-			<< archive << std::endl;
-		return false;
+		return get_u32( p ) | ( (sf::Uint64)get_u32( p + 4 ) << 32 );
 	}
 
-	int index = mz_zip_reader_locate_file( &zip,
-		filename, NULL, 0 );
-	if ( index < 0 )
+	int fe_file_seek( FILE *f, sf::Int64 pos )
 	{
-		mz_zip_reader_end( &zip );
-		return false;
+#ifdef SFML_SYSTEM_WINDOWS
+		return _fseeki64( f, pos, SEEK_SET );
+#else
+		return fseeko( f, pos, SEEK_SET );
+#endif
 	}
 
-	mz_zip_archive_file_stat file_stat;
-	if ( !mz_zip_reader_file_stat(&zip, index, &file_stat) )
+	bool read_at( FILE *f, sf::Int64 pos, void *buff, size_t len )
 	{
-		FeLog() << "Error reading filestats. zip: "
-			<< archive << ", file: " << filename << std::endl;
-		mz_zip_reader_end( &zip );
-		return false;
+		if ( fe_file_seek( f, pos ) != 0 )
+			return false;
+
+		return ( fread( buff, 1, len, f ) == len );
 	}
 
-	buff.resize( file_stat.m_uncomp_size );
+	bool read_zip_index( const std::string &archive, FeZipIndex &index )
+	{
+		FILE *f = nowide::fopen( archive.c_str(), "rb" );
+		if ( !f )
+			return false;
+
+		//
+		// Find the end of central directory record, which is followed by a
+		// comment of up to 64k
+		//
+		size_t tail_len = (size_t)std::min( index.file_size,
+			(sf::Int64)( ZIP_EOCD_SIZE + 0xFFFF ) );
+
+		std::vector< unsigned char > tail( tail_len );
+		if (( tail_len < ZIP_EOCD_SIZE )
+				|| !read_at( f, index.file_size - tail_len, &(tail[0]), tail_len ))
+		{
+			fclose( f );
+			return false;
+		}
+
+		int eocd = -1;
+		for ( int i=tail_len - ZIP_EOCD_SIZE; i >= 0; i-- )
+		{
+			if ( get_u32( &(tail[i]) ) == 0x06054b50 )
+			{
+				eocd = i;
+				break;
+			}
+		}
+
+		if ( eocd < 0 )
+		{
+			fclose( f );
+			return false;
+		}
+
+		sf::Uint64 count = get_u16( &(tail[eocd+10]) );
+		sf::Uint64 cd_size = get_u32( &(tail[eocd+12]) );
+		sf::Uint64 cd_offset = get_u32( &(tail[eocd+16]) );
 
-	if ( !mz_zip_reader_extract_to_mem( &zip,
-		index, &(buff[0]), buff.size(), 0 ) )
+		//
+		// Zip64 archives have another end of central directory record,
+		// located by the 20 byte locator that precedes the regular one
+		//
+		if ((( count == 0xFFFF ) || ( cd_size == 0xFFFFFFFF ) || ( cd_offset == 0xFFFFFFFF ))
+				&& ( eocd >= 20 )
+				&& ( get_u32( &(tail[eocd-20]) ) == 0x07064b50 ))
+		{
+			unsigned char z64[56];
+			if ( !read_at( f, get_u64( &(tail[eocd-12]) ), z64, sizeof( z64 ) )
+					|| ( get_u32( z64 ) != 0x06064b50 ))
+			{
+				fclose( f );
+				return false;
+			}
+
+			count = get_u64( z64 + 32 );
+			cd_size = get_u64( z64 + 40 );
+			cd_offset = get_u64( z64 + 48 );
+		}
+
+		//
+		// Don't trust these, they come from the file.  Every entry takes up
+		// at least a header's worth of the central directory
+		//
+		if (( cd_size > (sf::Uint64)index.file_size )
+				|| ( cd_offset > (sf::Uint64)index.file_size - cd_size )
+				|| ( count > cd_size / ZIP_CD_HEADER_SIZE ))
+		{
+			fclose( f );
+			return false;
+		}
+
+		std::vector< unsigned char > cd( cd_size );
+		if (( cd_size > 0 ) && !read_at( f, cd_offset, &(cd[0]), cd_size ))
+		{
+			fclose( f );
+			return false;
+		}
+
+		fclose( f );
+
+		index.entries.reserve( count );
+
+		size_t pos = 0;
+		for ( sf::Uint64 i=0; i<count; i++ )
+		{
+			if (( pos + ZIP_CD_HEADER_SIZE > cd.size() )
+					|| ( get_u32( &(cd[pos]) ) != 0x02014b50 ))
+				return false;
+
+			const unsigned char *h = &(cd[pos]);
+			size_t name_len = get_u16( h + 28 );
+			size_t extra_len = get_u16( h + 30 );
+			size_t comment_len = get_u16( h + 32 );
+
+			if ( pos + ZIP_CD_HEADER_SIZE + name_len + extra_len + comment_len > cd.size() )
+				return false;
+
+			FeZipEntry e;
+			e.flags = get_u16( h + 8 );
+			e.method = get_u16( h + 10 );
+			e.comp_size = get_u32( h + 20 );
+			e.size = get_u32( h + 24 );
+			e.header_offset = get_u32( h + 42 );
+			e.data_offset = -1;
+			e.name.assign( (const char *)h + ZIP_CD_HEADER_SIZE, name_len );
+
+			//
+			// Values that don't fit are stored in the zip64 extra field
+			//
+			const unsigned char *x = h + ZIP_CD_HEADER_SIZE + name_len;
+			const unsigned char *x_end = x + extra_len;
+			while ( x + 4 <= x_end )
+			{
+				sf::Uint16 id = get_u16( x );
+				sf::Uint16 len = get_u16( x + 2 );
+				const unsigned char *v = x + 4;
+				const unsigned char *v_end = std::min( v + len, x_end );
+
+				if ( id == 0x0001 )
+				{
+					if (( e.size == 0xFFFFFFFF ) && ( v + 8 <= v_end ))
+					{
+						e.size = get_u64( v );
+						v += 8;
+					}
+					if (( e.comp_size == 0xFFFFFFFF ) && ( v + 8 <= v_end ))
+					{
+						e.comp_size = get_u64( v );
+						v += 8;
+					}
+					if (( e.header_offset == 0xFFFFFFFF ) && ( v + 8 <= v_end ))
+						e.header_offset = get_u64( v );
+
+					break;
+				}
+
+				x += 4 + len;
+			}
+
+			index.names.insert( std::pair< std::string, size_t >( e.name, index.entries.size() ) );
+			index.entries.push_back( e );
+
+			pos += ZIP_CD_HEADER_SIZE + name_len + extra_len + comment_len;
+		}
+
+		return true;
+	}
+
+	//
+	// Return the cached index for "archive", reading it if needed.  Must be
+	// called with g_icache_mutex locked.  Returns NULL if "archive" isn't a
+	// zip file that we can index
+	//
+	FeZipIndex *get_zip_index( const std::string &archive )
 	{
-		FeLog() << "Error extracting to buffer. zip: "
-			<< archive << ", file: " << filename << std::endl;
-		mz_zip_reader_end( &zip );
-		return false;
+		if ( !tail_compare( archive, ".zip" ) )
+			return NULL;
+
+		sf::Int64 size( 0 ), mtime( 0 );
+		if ( !get_file_info( archive, size, mtime ) )
+			return NULL;
+
+		std::list< std::pair< std::string, FeZipIndex > >::iterator itr;
+		for ( itr = g_icache.begin(); itr != g_icache.end(); ++itr )
+		{
+			if ( (*itr).first.compare( archive ) == 0 )
+				break;
+		}
+
+		if ( itr != g_icache.end() )
+		{
+			if (( (*itr).second.file_size == size ) && ( (*itr).second.mtime == mtime ))
+			{
+				// Promote hit to the front of the cache
+				g_icache.splice( g_icache.begin(), g_icache, itr );
+				return &( g_icache.front().second );
+			}
+
+			g_icache.erase( itr );
+		}
+
+		g_icache.push_front( std::pair< std::string, FeZipIndex >( archive, FeZipIndex() ) );
+
+		FeZipIndex &index = g_icache.front().second;
+		index.file_size = size;
+		index.mtime = mtime;
+
+		if ( !read_zip_index( archive, index ) )
+		{
+			FeDebug() << "Unable to index zip, falling back: " << archive << std::endl;
+			g_icache.pop_front();
+			return NULL;
+		}
+
+		if ( (int)g_icache.size() > INDEX_CACHE_SIZE )
+			g_icache.pop_back();
+
+		return &index;
 	}
 
-	mz_zip_reader_end( &zip );
-	return true;
-}
+	enum FeZipLookup { ZipFound, ZipNotFound, ZipNotIndexed };
 
-bool fe_zip_get_dir(
+	FeZipLookup find_zip_entry( const std::string &archive,
+		const std::string &filename,
+		FeZipEntry &entry )
+	{
+		sf::Lock l( g_icache_mutex );
+
+		FeZipIndex *index = get_zip_index( archive );
+		if ( !index )
+			return ZipNotIndexed;
+
+		std::map< std::string, size_t >::iterator itr = index->names.find( filename );
+		if ( itr == index->names.end() )
+			return ZipNotFound;
+
+		entry = index->entries[ (*itr).second ];
+
+		// we only handle unencrypted stored or deflated entries
+		if (( entry.flags & 0x01 ) || (( entry.method != 0 ) && ( entry.method != 8 )))
+			return ZipNotIndexed;
+
+		return ZipFound;
+	}
+};
+
+bool fe_zip_open_to_buff(
 	const char *archive,
-	std::vector<std::string> &result )
+	const char *filename,
+	std::vector< char > &buff )
 {
-	sf::Lock l( g_ccache_mutex );
-	if ( check_content_cache( archive, result ) )
-		return true;
+	FeZipEntry entry;
+	switch ( find_zip_entry( archive, filename, entry ) )
+	{
+	case ZipFound:
+		{
+			FeZipStream zs( archive );
+			if ( !zs.open( filename ) )
+				return false;
 
-	mz_zip_archive zip;
-	memset( &zip, 0, sizeof( zip ) );
+			buff.resize( zs.getSize() );
+			return ( buff.empty()
+				|| ( zs.read( &(buff[0]), buff.size() ) == (sf::Int64)buff.size() ));
+		}
 
-	if ( !mz_zip_reader_init_file( &zip, archive, 0 ) )
-	{
-		FeLog() << "Error initializing zip: "
-			<< archive << std::endl;
+	case ZipNotFound:
 		return false;
+
+	default:
+		return archive_open_to_buff( archive, filename, buff );
 	}
+}
 
-	for ( int i=0; i<(int)mz_zip_reader_get_num_files(&zip); i++)
+bool fe_zip_get_dir(
+	const char *archive,
+	std::vector<std::string> &result )
+{
 	{
-		mz_zip_archive_file_stat file_stat;
-		if ( mz_zip_reader_file_stat(&zip, i, &file_stat) )
-			result.push_back( file_stat.m_filename );
+		sf::Lock l( g_icache_mutex );
+
+		FeZipIndex *index = get_zip_index( archive );
+		if ( index )
+		{
+			for ( std::vector< FeZipEntry >::iterator itr=index->entries.begin();
+					itr != index->entries.end(); ++itr )
+				result.push_back( (*itr).name );
+
+			return true;
+		}
 	}
 
-	mz_zip_reader_end( &zip );
+	sf::Lock l( g_ccache_mutex );
+	if ( check_content_cache( archive, result ) )
+		return true;
+
+	if ( !archive_get_dir( archive, result ) )
+		return false;
 
 	add_to_content_cache( archive, result );
 	return true;
 }
 
-#endif // USE_LIBARCHIVE
-
 const char *FE_ARCHIVE_EXT[] =
 {
 	".zip",
@@ -334,14 +677,34 @@ void *zip_stream_alloc_cb( size_t s )
 	return (void *)(new char[s]);
 }
 
+namespace
+{
+	const size_t ZIP_READ_BUFFER_SIZE = 65536;
+};
+
+//
+// State for inflating a deflated zip entry as it is read
+//
+struct FeZipStream::FeZipInflater
+{
+	z_stream zs;
+	std::vector< char > buff;
+	sf::Int64 pos; // uncompressed position
+	sf::Int64 comp_left; // compressed bytes not yet read from the archive
+};
+
 FeZipStream::FeZipStream()
-	: m_pos( 0 )
+	: m_pos( 0 ),
+	m_file( NULL ),
+	m_inflater( NULL )
 {
 }
 
 FeZipStream::FeZipStream( const std::string &archive )
 	: m_archive( archive ),
-	m_pos( 0 )
+	m_pos( 0 ),
+	m_file( NULL ),
+	m_inflater( NULL )
 {
 }
 
@@ -354,48 +717,215 @@ void FeZipStream::clear()
 {
 	m_data.resize( 0 );
 	m_pos = 0;
+
+	end_inflate();
+
+	if ( m_file )
+	{
+		fclose( m_file );
+		m_file = NULL;
+	}
 }
 
 bool FeZipStream::open( const std::string &filename )
 {
 	clear();
 
-	return fe_zip_open_to_buff(
-		m_archive.c_str(),
-		filename.c_str(),
-		m_data );
+	switch ( find_zip_entry( m_archive, filename, m_entry ) )
+	{
+	case ZipFound:
+		break;
+
+	case ZipNotFound:
+		return false;
+
+	default:
+		return archive_open_to_buff(
+			m_archive.c_str(),
+			filename.c_str(),
+			m_data );
+	}
+
+	m_file = nowide::fopen( m_archive.c_str(), "rb" );
+	if ( !m_file )
+		return false;
+
+	//
+	// The entry's data follows its local header, which can have a
+	// different extra field than the central directory entry
+	//
+	unsigned char h[ ZIP_LOCAL_HEADER_SIZE ];
+	if ( !read_at( m_file, m_entry.header_offset, h, sizeof( h ) )
+			|| ( get_u32( h ) != 0x04034b50 ))
+	{
+		FeLog() << "Error reading zip entry: " << m_archive
+			<< ", file: " << filename << std::endl;
+
+		clear();
+		return false;
+	}
+
+	m_entry.data_offset = m_entry.header_offset + ZIP_LOCAL_HEADER_SIZE
+		+ get_u16( h + 26 ) + get_u16( h + 28 );
+
+	return true;
+}
+
+bool FeZipStream::start_inflate()
+{
+	end_inflate();
+
+	m_inflater = new FeZipInflater;
+	memset( &( m_inflater->zs ), 0, sizeof( z_stream ) );
+
+	// raw deflate data, no zlib header
+	if ( inflateInit2( &( m_inflater->zs ), -MAX_WBITS ) != Z_OK )
+	{
+		delete m_inflater;
+		m_inflater = NULL;
+		return false;
+	}
+
+	m_inflater->buff.resize( ZIP_READ_BUFFER_SIZE );
+	m_inflater->pos = 0;
+	m_inflater->comp_left = m_entry.comp_size;
+
+	return ( fe_file_seek( m_file, m_entry.data_offset ) == 0 );
+}
+
+void FeZipStream::end_inflate()
+{
+	if ( m_inflater )
+	{
+		inflateEnd( &( m_inflater->zs ) );
+		delete m_inflater;
+		m_inflater = NULL;
+	}
+}
+
+sf::Int64 FeZipStream::inflate_data( char *data, sf::Int64 size )
+{
+	z_stream &zs = m_inflater->zs;
+	zs.next_out = (Bytef *)data;
+	zs.avail_out = size;
+
+	while ( zs.avail_out > 0 )
+	{
+		if (( zs.avail_in == 0 ) && ( m_inflater->comp_left > 0 ))
+		{
+			size_t len = (size_t)std::min( m_inflater->comp_left,
+				(sf::Int64)m_inflater->buff.size() );
+
+			len = fread( &(m_inflater->buff[0]), 1, len, m_file );
+			if ( len == 0 )
+				break;
+
+			m_inflater->comp_left -= len;
+			zs.next_in = (Bytef *)&(m_inflater->buff[0]);
+			zs.avail_in = len;
+		}
+
+		int r = inflate( &zs, Z_NO_FLUSH );
+		if ( r == Z_STREAM_END )
+			break;
+
+		if ( r != Z_OK )
+		{
+			FeLog() << "Error inflating zip entry: " << m_archive
+				<< ", file: " << m_entry.name << std::endl;
+			break;
+		}
+	}
+
+	sf::Int64 count = size - zs.avail_out;
+	m_inflater->pos += count;
+	return count;
 }
 
 sf::Int64 FeZipStream::read( void *data, sf::Int64 size )
 {
-	if ( m_data.empty() )
-		return -1;
+	if ( !m_file || !m_data.empty() )
+	{
+		if ( m_data.empty() )
+			return -1;
+
+		sf::Int64 end_pos = m_pos + size;
+		size_t count = ( end_pos <= (sf::Int64)m_data.size() )
+			? size : ( m_data.size() - m_pos );
+
+		if ( count > 0 )
+		{
+			memcpy( data, &(m_data[m_pos]), count );
+			m_pos += count;
+		}
+
+		return count;
+	}
 
-	sf::Int64 end_pos = m_pos + size;
-	size_t count = ( end_pos <= (sf::Int64)m_data.size() )
-		? size : ( m_data.size() - m_pos );
+	if ( m_pos + size > m_entry.size )
+		size = m_entry.size - m_pos;
 
-	if ( count > 0 )
+	if ( size <= 0 )
+		return 0;
+
+	sf::Int64 count( 0 );
+
+	if ( m_entry.method == 0 )
 	{
-		memcpy( data, &(m_data[m_pos]), count );
-		m_pos += count;
+		//
+		// Stored entries are read straight from the archive
+		//
+		if ( fe_file_seek( m_file, m_entry.data_offset + m_pos ) == 0 )
+			count = fread( data, 1, (size_t)size, m_file );
+	}
+	else
+	{
+		//
+		// Deflated entries are inflated as they are read.  Seeking back
+		// means starting over from the beginning of the entry, which
+		// streams that seek around a lot (i.e. videos) would end up doing
+		// over and over.  So entries that aren't too big get inflated into
+		// memory once instead, and are read from there after that
+		//
+		if (( m_inflater ) && ( m_pos < m_inflater->pos )
+				&& ( m_entry.size <= ZIP_INFLATE_BUFFER_LIMIT )
+				&& getData() )
+			return read( data, size );
+
+		if (( !m_inflater ) || ( m_pos < m_inflater->pos ))
+		{
+			if ( !start_inflate() )
+				return -1;
+		}
+
+		while ( m_inflater->pos < m_pos )
+		{
+			char skip[4096];
+			sf::Int64 len = std::min( m_pos - m_inflater->pos, (sf::Int64)sizeof( skip ) );
+			if ( inflate_data( skip, len ) < len )
+				return -1;
+		}
+
+		count = inflate_data( (char *)data, size );
 	}
 
+	m_pos += count;
 	return count;
 }
 
 sf::Int64 FeZipStream::seek( sf::Int64 position )
 {
-	if ( m_data.empty() )
+	sf::Int64 size = getSize();
+	if ( size < 0 )
 		return -1;
 
-	m_pos = ( position < (sf::Int64)m_data.size() ) ? position : m_data.size();
+	m_pos = ( position < size ) ? position : size;
 	return m_pos;
 }
 
 sf::Int64 FeZipStream::tell()
 {
-	if ( m_data.empty() )
+	if ( !m_file && m_data.empty() )
 		return -1;
 
 	return m_pos;
@@ -403,6 +933,9 @@ sf::Int64 FeZipStream::tell()
 
 sf::Int64 FeZipStream::getSize()
 {
+	if ( m_file )
+		return m_entry.size;
+
 	if ( m_data.empty() )
 		return -1;
 
@@ -417,6 +950,27 @@ void FeZipStream::setArchive( const std::string &archive )
 
 char *FeZipStream::getData()
 {
+	//
+	// Read the whole entry into memory the first time this is used
+	//
+	if ( m_file && m_data.empty() && ( m_entry.size > 0 ))
+	{
+		sf::Int64 pos = m_pos;
+		std::vector< char > temp( m_entry.size );
+
+		end_inflate();
+
+		m_pos = 0;
+		if ( read( &(temp[0]), temp.size() ) == (sf::Int64)temp.size() )
+			m_data.swap( temp );
+
+		end_inflate();
+		m_pos = pos;
+	}
+
+	if ( m_data.empty() )
+		return NULL;
+
 	return &(m_data[0]);
 }
 
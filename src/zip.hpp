@@ -25,6 +25,7 @@
 
 #include <string>
 #include <vector>
+#include <cstdio>
 #include <SFML/System/InputStream.hpp>
 #include <SFML/System/NonCopyable.hpp>
 
@@ -64,6 +65,23 @@ bool get_archive_filename_with_base(
 extern const char *FE_ARCHIVE_EXT[];
 bool is_supported_archive( const std::string & );
 
+struct FeZipEntry
+{
+	std::string name;
+	sf::Uint16 flags;
+	sf::Uint16 method;
+	sf::Int64 comp_size;
+	sf::Int64 size;
+	sf::Int64 header_offset; // offset of the entry's local header in the archive
+	sf::Int64 data_offset; // offset of the entry's data, once known
+};
+
+//
+// Input stream for a file in an archive.  Stored and deflated files in zip
+// archives are read directly from the archive as needed (deflated files
+// that are seeked backwards in get read into memory, if not too big).
+// Anything else is read into memory when opened.
+//
 class FeZipStream : public sf::InputStream, sf::NonCopyable
 {
 public:
@@ -79,14 +97,27 @@ public:
 	sf::Int64 tell();
 	sf::Int64 getSize();
 	void setArchive( const std::string &archive );
+
+	// Returns the file's entire contents, reading it into memory if
+	// needed.  Returns NULL if the entry is empty or couldn't be read
 	char *getData();
 
 private:
+	struct FeZipInflater;
+
 	void clear();
+	bool start_inflate();
+	void end_inflate();
+	sf::Int64 inflate_data( char *data, sf::Int64 size );
 
 	std::string m_archive;
 	std::vector < char > m_data;
 	sf::Int64 m_pos;
+
+	// used when reading directly from a zip archive
+	FILE *m_file;
+	FeZipEntry m_entry;
+	FeZipInflater *m_inflater;
 };
 
 #endif